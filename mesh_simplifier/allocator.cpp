@@ -0,0 +1,163 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "allocator.h"
+
+#ifdef MESH_SIMPLIFIER_MIMALLOC
+// linking mimalloc-override redirects the CRT heap of every module in the process,
+// including the MeshLab libraries and plugins, not just this executable.
+#include <mimalloc.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string to_megabytes(size_t bytes)
+	{
+		return std::to_string(bytes / (1024 * 1024)) + "MB";
+	}
+
+#ifdef MESH_SIMPLIFIER_MIMALLOC
+	void append_statistics_line(const char* message, void* arg)
+	{
+		auto* p_lines = static_cast<std::vector<std::string>*>(arg);
+
+		std::string line = message;
+		while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+		{
+			line.pop_back();
+		}
+		if (!line.empty())
+		{
+			p_lines->push_back(line);
+		}
+	}
+#endif
+}
+
+std::string allocator_name()
+{
+#ifdef MESH_SIMPLIFIER_MIMALLOC
+	// mi_version() encodes major.minor.patch as one number, e.g. 212 for 2.1.2
+	const int version = mi_version();
+
+	return "mimalloc " + std::to_string(version / 100) + "." + std::to_string(version / 10 % 10) + "." +
+		std::to_string(version % 10);
+#else
+	return "system";
+#endif
+}
+
+bool configure_allocator(bool use_huge_pages)
+{
+#ifdef MESH_SIMPLIFIER_MIMALLOC
+	// large OS pages back the big vertex and face arrays with 2MB pages where the OS allows it
+	// (SeLockMemoryPrivilege on Windows, transparent huge pages on Linux).
+	mi_option_set_enabled(mi_option_large_os_pages, use_huge_pages);
+	mi_option_set_enabled(mi_option_show_errors, true);
+
+	return true;
+#else
+	return !use_huge_pages;
+#endif
+}
+
+std::vector<std::string> allocator_statistics()
+{
+	std::vector<std::string> lines;
+
+#ifdef MESH_SIMPLIFIER_MIMALLOC
+	size_t elapsed_msecs = 0;
+	size_t user_msecs = 0;
+	size_t system_msecs = 0;
+	size_t current_rss = 0;
+	size_t peak_rss = 0;
+	size_t current_commit = 0;
+	size_t peak_commit = 0;
+	size_t page_faults = 0;
+	mi_process_info(&elapsed_msecs, &user_msecs, &system_msecs, &current_rss, &peak_rss, &current_commit,
+	                &peak_commit, &page_faults);
+
+	lines.push_back("allocator : " + allocator_name());
+	lines.push_back("rss : " + to_megabytes(current_rss) + ", peak rss : " + to_megabytes(peak_rss));
+	lines.push_back("committed : " + to_megabytes(current_commit) + ", peak committed : " + to_megabytes(peak_commit));
+	lines.push_back("page faults : " + std::to_string(page_faults));
+
+	// per size-class arena usage and fragmentation as reported by mimalloc itself
+	mi_stats_print_out(append_statistics_line, &lines);
+#elif defined(_WIN32)
+	lines.push_back("allocator : " + allocator_name());
+
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		lines.push_back("working set : " + to_megabytes(counters.WorkingSetSize) + ", peak working set : " +
+			to_megabytes(counters.PeakWorkingSetSize));
+		lines.push_back("committed : " + to_megabytes(counters.PagefileUsage) + ", peak committed : " +
+			to_megabytes(counters.PeakPagefileUsage));
+		lines.push_back("page faults : " + std::to_string(counters.PageFaultCount));
+	}
+
+	ULONG heap_information = 0;
+	if (HeapQueryInformation(GetProcessHeap(), HeapCompatibilityInformation, &heap_information,
+	                         sizeof(heap_information), nullptr))
+	{
+		lines.push_back(std::string("process heap : ") + (heap_information == 2 ? "low fragmentation" : "standard"));
+	}
+#elif defined(__linux__)
+	lines.push_back("allocator : " + allocator_name());
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		lines.push_back("peak rss : " + to_megabytes(static_cast<size_t>(usage.ru_maxrss) * 1024));
+		lines.push_back("page faults : " + std::to_string(usage.ru_majflt + usage.ru_minflt));
+	}
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	const struct mallinfo2 info = mallinfo2();
+	const size_t arena_bytes = info.arena + info.hblkhd;
+	const size_t used_bytes = info.uordblks + info.hblkhd;
+	lines.push_back("arena : " + to_megabytes(arena_bytes) + ", in use : " + to_megabytes(used_bytes) +
+		", free : " + to_megabytes(info.fordblks));
+	if (0 < arena_bytes)
+	{
+		lines.push_back("fragmentation : " + std::to_string(100 * info.fordblks / arena_bytes) + "%");
+	}
+#endif
+#else
+	lines.push_back("allocator : " + allocator_name());
+#endif
+
+	return lines;
+}
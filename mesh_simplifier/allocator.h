@@ -0,0 +1,37 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// name of the heap allocator compiled into the executable ("mimalloc" or "system").
+std::string allocator_name();
+
+// applies per-run allocator options. must be called before the first large allocation.
+// returns false when an option is not supported by the compiled-in allocator.
+bool configure_allocator(bool use_huge_pages);
+
+// human readable allocator and process memory statistics, one line per entry.
+std::vector<std::string> allocator_statistics();
@@ -0,0 +1,360 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "async_appender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <exception>
+
+namespace
+{
+	constexpr size_t batch_size = 256;
+	constexpr std::chrono::milliseconds idle_wait(20);
+
+	std::mutex live_appenders_mutex;
+	std::vector<AsyncAppender*> live_appenders;
+
+	size_t round_up_to_power_of_two(size_t value)
+	{
+		size_t result = 2;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+
+		return result;
+	}
+
+	void flush_on_signal(int signal_number)
+	{
+		AsyncAppender::flush_all();
+
+		std::signal(signal_number, SIG_DFL);
+		std::raise(signal_number);
+	}
+}
+
+AsyncAppender::AsyncAppender(const std::string& name, size_t capacity, OverflowPolicy overflow_policy)
+	: AppenderSkeleton(name), mask_(round_up_to_power_of_two(capacity) - 1), cells_(new Cell[mask_ + 1]),
+	  overflow_policy_(overflow_policy)
+{
+	for (size_t i = 0; i <= mask_; ++i)
+	{
+		cells_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(live_appenders_mutex);
+		live_appenders.push_back(this);
+	}
+
+	writer_thread_ = std::thread(&AsyncAppender::run, this);
+}
+
+AsyncAppender::~AsyncAppender()
+{
+	close();
+
+	std::lock_guard<std::mutex> lock(live_appenders_mutex);
+	live_appenders.erase(std::remove(live_appenders.begin(), live_appenders.end(), this), live_appenders.end());
+}
+
+void AsyncAppender::addAppender(log4cpp::Appender* p_appender)
+{
+	std::lock_guard<std::mutex> lock(write_mutex_);
+
+	appenders_.emplace_back(p_appender);
+}
+
+bool AsyncAppender::reopen()
+{
+	flush();
+
+	std::lock_guard<std::mutex> lock(write_mutex_);
+
+	bool result = true;
+	for (const auto& p_appender : appenders_)
+	{
+		result = p_appender->reopen() && result;
+	}
+
+	return result;
+}
+
+void AsyncAppender::close()
+{
+	if (stopping_.exchange(true))
+	{
+		return;
+	}
+
+	wake_condition_.notify_one();
+	if (writer_thread_.joinable())
+	{
+		writer_thread_.join();
+	}
+
+	// whatever was appended while the writer was shutting down
+	while (drain(batch_size) != 0)
+	{
+	}
+	report_dropped_events();
+
+	std::lock_guard<std::mutex> lock(write_mutex_);
+	for (const auto& p_appender : appenders_)
+	{
+		p_appender->close();
+	}
+}
+
+bool AsyncAppender::requiresLayout() const
+{
+	return false;
+}
+
+void AsyncAppender::setLayout(log4cpp::Layout* p_layout)
+{
+	// the target appenders format the events
+	delete p_layout;
+}
+
+void AsyncAppender::flush()
+{
+	const std::uint64_t target_count = appended_count_.load();
+	while (written_count_.load() < target_count)
+	{
+		if (stopping_ || drain(batch_size) == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void AsyncAppender::flush_all()
+{
+	// try_lock: a crash while the list is being modified must not deadlock
+	std::unique_lock<std::mutex> lock(live_appenders_mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+	{
+		return;
+	}
+
+	for (AsyncAppender* p_appender : live_appenders)
+	{
+		// the crash may have happened inside the writer while it held the targets
+		std::unique_lock<std::mutex> write_lock(p_appender->write_mutex_, std::defer_lock);
+		for (int attempt = 0; attempt < 100 && !write_lock.try_lock(); ++attempt)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (!write_lock.owns_lock())
+		{
+			continue;
+		}
+
+		while (p_appender->write_queued_events(batch_size) != 0)
+		{
+		}
+	}
+}
+
+void AsyncAppender::install_crash_handlers()
+{
+	static std::terminate_handler previous_handler = std::set_terminate([]
+	{
+		AsyncAppender::flush_all();
+
+		if (previous_handler != nullptr)
+		{
+			previous_handler();
+		}
+		std::abort();
+	});
+
+	for (const int signal_number : {SIGSEGV, SIGABRT, SIGFPE, SIGILL})
+	{
+		std::signal(signal_number, flush_on_signal);
+	}
+}
+
+void AsyncAppender::_append(const log4cpp::LoggingEvent& event)
+{
+	if (stopping_)
+	{
+		// the writer is gone: keep the ordering by writing through directly
+		std::lock_guard<std::mutex> lock(write_mutex_);
+		for (const auto& p_appender : appenders_)
+		{
+			p_appender->doAppend(event);
+		}
+
+		return;
+	}
+
+	while (!try_push(event))
+	{
+		if (overflow_policy_ == OverflowPolicy::drop)
+		{
+			dropped_count_.fetch_add(1, std::memory_order_relaxed);
+
+			return;
+		}
+
+		wake_condition_.notify_one();
+		std::this_thread::yield();
+	}
+	appended_count_.fetch_add(1, std::memory_order_relaxed);
+
+	if (writer_waiting_.load(std::memory_order_relaxed))
+	{
+		wake_condition_.notify_one();
+	}
+}
+
+// bounded multi-producer multi-consumer queue after Dmitry Vyukov: every cell carries a sequence number
+// telling producers and consumers whose turn it is, so neither side ever takes a lock.
+bool AsyncAppender::try_push(const log4cpp::LoggingEvent& event)
+{
+	size_t position = enqueue_position_.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = cells_[position & mask_];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+		if (difference == 0)
+		{
+			if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				cell.event.emplace(event);
+				cell.sequence.store(position + 1, std::memory_order_release);
+
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			return false;
+		}
+		else
+		{
+			position = enqueue_position_.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+std::optional<log4cpp::LoggingEvent> AsyncAppender::try_pop()
+{
+	size_t position = dequeue_position_.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = cells_[position & mask_];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+		if (difference == 0)
+		{
+			if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				std::optional<log4cpp::LoggingEvent> result = std::move(cell.event);
+				cell.event.reset();
+				cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+
+				return result;
+			}
+		}
+		else if (difference < 0)
+		{
+			return std::nullopt;
+		}
+		else
+		{
+			position = dequeue_position_.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+size_t AsyncAppender::drain(size_t max_count)
+{
+	std::lock_guard<std::mutex> lock(write_mutex_);
+
+	return write_queued_events(max_count);
+}
+
+size_t AsyncAppender::write_queued_events(size_t max_count)
+{
+	size_t count = 0;
+	while (count < max_count)
+	{
+		std::optional<log4cpp::LoggingEvent> event = try_pop();
+		if (!event)
+		{
+			break;
+		}
+
+		for (const auto& p_appender : appenders_)
+		{
+			p_appender->doAppend(*event);
+		}
+		++count;
+	}
+	written_count_.fetch_add(count, std::memory_order_release);
+
+	return count;
+}
+
+void AsyncAppender::run()
+{
+	while (!stopping_)
+	{
+		if (drain(batch_size) != 0)
+		{
+			continue;
+		}
+
+		report_dropped_events();
+
+		std::unique_lock<std::mutex> lock(wake_mutex_);
+		writer_waiting_ = true;
+		wake_condition_.wait_for(lock, idle_wait);
+		writer_waiting_ = false;
+	}
+}
+
+void AsyncAppender::report_dropped_events()
+{
+	const std::uint64_t dropped_count = dropped_count_.exchange(0);
+	if (dropped_count == 0)
+	{
+		return;
+	}
+
+	const log4cpp::LoggingEvent event(getName(), std::to_string(dropped_count) + " log events dropped", "",
+	                                  log4cpp::Priority::WARN);
+
+	std::lock_guard<std::mutex> lock(write_mutex_);
+	for (const auto& p_appender : appenders_)
+	{
+		p_appender->doAppend(event);
+	}
+}
@@ -0,0 +1,111 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <log4cpp/AppenderSkeleton.hh>
+#include <log4cpp/LoggingEvent.hh>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// forwards logging events to its target appenders from a dedicated writer thread, so that workers only pay
+// for copying the event into a bounded lock-free ring buffer. the ring is drained in batches and flushed
+// when the appender is closed or destroyed (category.shutdown() does both) and, best effort, on a crash.
+class AsyncAppender : public log4cpp::AppenderSkeleton
+{
+public:
+	enum class OverflowPolicy
+	{
+		// wait for the writer to make room
+		block,
+		// discard the event and report the number of dropped events later
+		drop,
+	};
+
+	AsyncAppender(const std::string& name, size_t capacity, OverflowPolicy overflow_policy);
+	~AsyncAppender() override;
+
+	// takes ownership; must be called before the first event is appended.
+	void addAppender(log4cpp::Appender* p_appender);
+
+	bool reopen() override;
+	void close() override;
+	bool requiresLayout() const override;
+	void setLayout(log4cpp::Layout* p_layout) override;
+
+	// blocks until every event appended so far has been written.
+	void flush();
+
+	// flushes every live async appender; used by the crash handlers.
+	static void flush_all();
+
+	// flushes the logs on std::terminate and on fatal signals before the process goes down.
+	static void install_crash_handlers();
+
+protected:
+	void _append(const log4cpp::LoggingEvent& event) override;
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		std::optional<log4cpp::LoggingEvent> event;
+	};
+
+	bool try_push(const log4cpp::LoggingEvent& event);
+	std::optional<log4cpp::LoggingEvent> try_pop();
+	// writes up to max_count queued events, returns how many were written
+	size_t drain(size_t max_count);
+	// same as drain, with write_mutex_ already held
+	size_t write_queued_events(size_t max_count);
+	void run();
+	void report_dropped_events();
+
+	const size_t mask_;
+	std::unique_ptr<Cell[]> cells_;
+	alignas(64) std::atomic<size_t> enqueue_position_{0};
+	alignas(64) std::atomic<size_t> dequeue_position_{0};
+
+	const OverflowPolicy overflow_policy_;
+	std::atomic<std::uint64_t> dropped_count_{0};
+	std::atomic<std::uint64_t> appended_count_{0};
+	std::atomic<std::uint64_t> written_count_{0};
+
+	std::vector<std::unique_ptr<log4cpp::Appender>> appenders_;
+	// serialises the writer thread with flushes from other threads on the target appenders
+	std::mutex write_mutex_;
+
+	std::mutex wake_mutex_;
+	std::condition_variable wake_condition_;
+	std::atomic<bool> writer_waiting_{false};
+	std::atomic<bool> stopping_{false};
+	std::thread writer_thread_;
+};
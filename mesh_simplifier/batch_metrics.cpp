@@ -0,0 +1,290 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "batch_metrics.h"
+
+#include "progress.h"
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+	std::string format_value(double value)
+	{
+		if (value == std::numeric_limits<double>::infinity())
+		{
+			return "+Inf";
+		}
+
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+
+		return buffer;
+	}
+
+	std::string with_label(const std::string& labels, const std::string& label)
+	{
+		return "{" + labels + (labels.empty() ? "" : ",") + label + "}";
+	}
+
+	std::string escape_label_value(const std::string& value)
+	{
+		std::string result;
+		for (const char c : value)
+		{
+			if (c == '\n')
+			{
+				result += "\\n";
+				continue;
+			}
+
+			if (c == '\\' || c == '"')
+			{
+				result += '\\';
+			}
+			result += c;
+		}
+
+		return result;
+	}
+
+	void append_header(std::string& text, const std::string& name, const std::string& type, const std::string& help)
+	{
+		text += "# HELP " + name + " " + help + "\n";
+		text += "# TYPE " + name + " " + type + "\n";
+	}
+}
+
+MetricHistogram::MetricHistogram(std::vector<double> upper_bounds)
+	: upper_bounds_(std::move(upper_bounds)), bucket_counts_(new std::atomic<std::uint64_t>[upper_bounds_.size()])
+{
+	for (size_t i = 0; i < upper_bounds_.size(); ++i)
+	{
+		bucket_counts_[i] = 0;
+	}
+}
+
+void MetricHistogram::observe(double value)
+{
+	for (size_t i = 0; i < upper_bounds_.size(); ++i)
+	{
+		if (value <= upper_bounds_[i])
+		{
+			bucket_counts_[i].fetch_add(1, std::memory_order_relaxed);
+
+			break;
+		}
+	}
+	count_.fetch_add(1, std::memory_order_relaxed);
+
+	double sum = sum_.load(std::memory_order_relaxed);
+	while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+	{
+	}
+}
+
+std::string MetricHistogram::format(const std::string& name, const std::string& labels) const
+{
+	std::string text;
+
+	std::uint64_t cumulative_count = 0;
+	for (size_t i = 0; i < upper_bounds_.size(); ++i)
+	{
+		cumulative_count += bucket_counts_[i].load(std::memory_order_relaxed);
+		text += name + "_bucket" + with_label(labels, "le=\"" + format_value(upper_bounds_[i]) + "\"") + " " +
+			std::to_string(cumulative_count) + "\n";
+	}
+
+	const std::uint64_t count = count_.load(std::memory_order_relaxed);
+	const std::string braced_labels = labels.empty() ? "" : "{" + labels + "}";
+	text += name + "_bucket" + with_label(labels, "le=\"+Inf\"") + " " + std::to_string(count) + "\n";
+	text += name + "_sum" + braced_labels + " " + format_value(sum_.load(std::memory_order_relaxed)) + "\n";
+	text += name + "_count" + braced_labels + " " + std::to_string(count) + "\n";
+
+	return text;
+}
+
+BatchMetrics::BatchMetrics()
+	: faces_per_second_({1e3, 1e4, 1e5, 2.5e5, 5e5, 1e6, 2.5e6, 5e6, 1e7})
+{
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		stage_seconds_.push_back(std::make_unique<MetricHistogram>(
+			std::vector<double>{0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 300}));
+	}
+}
+
+void BatchMetrics::file_started()
+{
+	active_workers_.add(1);
+}
+
+void BatchMetrics::file_finished(const FileRecord& record)
+{
+	active_workers_.add(-1);
+
+	if (record.succeeded)
+	{
+		files_succeeded_.increment();
+	}
+	else if (record.error_stage == "import")
+	{
+		files_failed_import_.increment();
+	}
+	else if (record.error_stage == "simplify")
+	{
+		files_failed_simplify_.increment();
+	}
+	else if (record.error_stage == "export")
+	{
+		files_failed_export_.increment();
+	}
+	else if (record.error_stage == "overrides")
+	{
+		files_failed_overrides_.increment();
+	}
+	else if (record.error_stage == "deviation")
+	{
+		files_failed_deviation_.increment();
+	}
+	else if (record.error_stage == "clean_check")
+	{
+		files_failed_clean_check_.increment();
+	}
+	else if (record.error_stage.empty())
+	{
+		files_cancelled_.increment();
+	}
+
+	if (!record.succeeded)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		stage_seconds_[i]->observe(record.metrics.stage_seconds[i]);
+	}
+
+	faces_in_.increment(record.metrics.faces_in);
+	faces_out_.increment(record.metrics.faces_out);
+
+	const double simplify_seconds = record.metrics.seconds(Stage::simplify);
+	if (0.0 < simplify_seconds)
+	{
+		faces_per_second_.observe(record.metrics.faces_in / simplify_seconds);
+	}
+}
+
+bool BatchMetrics::write_textfile(const std::filesystem::path& textfile_path) const
+{
+	std::lock_guard<std::mutex> lock(textfile_mutex_);
+
+	std::filesystem::path temporary_path = textfile_path;
+	temporary_path += ".tmp";
+
+	{
+		std::ofstream stream(temporary_path, std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!stream.is_open())
+		{
+			return false;
+		}
+
+		stream << format();
+		if (!stream.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary_path, textfile_path, error);
+
+	return !error;
+}
+
+std::string BatchMetrics::format() const
+{
+	std::string text;
+
+	append_header(text, "mesh_simplifier_files_total", "counter", "Files processed, by outcome and failing stage.");
+	text += "mesh_simplifier_files_total{status=\"success\",stage=\"\"} " + std::to_string(files_succeeded_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"import\"} " + std::to_string(files_failed_import_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"simplify\"} " + std::to_string(files_failed_simplify_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"export\"} " + std::to_string(files_failed_export_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"overrides\"} " + std::to_string(files_failed_overrides_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"deviation\"} " + std::to_string(files_failed_deviation_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"fail\",stage=\"clean_check\"} " + std::to_string(files_failed_clean_check_.value()) + "\n";
+	text += "mesh_simplifier_files_total{status=\"cancelled\",stage=\"\"} " + std::to_string(files_cancelled_.value()) + "\n";
+
+	append_header(text, "mesh_simplifier_faces_in_total", "counter", "Faces read from successfully processed files.");
+	text += "mesh_simplifier_faces_in_total " + std::to_string(faces_in_.value()) + "\n";
+	append_header(text, "mesh_simplifier_faces_out_total", "counter", "Faces written to simplified files.");
+	text += "mesh_simplifier_faces_out_total " + std::to_string(faces_out_.value()) + "\n";
+
+	append_header(text, "mesh_simplifier_stage_duration_seconds", "histogram", "Time spent per file in each stage.");
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		text += stage_seconds_[i]->format("mesh_simplifier_stage_duration_seconds",
+		                                  std::string("stage=\"") + stage_name(static_cast<Stage>(i)) + "\"");
+	}
+
+	append_header(text, "mesh_simplifier_simplify_faces_per_second", "histogram", "Input faces simplified per second.");
+	text += faces_per_second_.format("mesh_simplifier_simplify_faces_per_second", "");
+
+	append_header(text, "mesh_simplifier_active_workers", "gauge", "Files currently being processed.");
+	text += "mesh_simplifier_active_workers " + std::to_string(active_workers_.value()) + "\n";
+
+	// one family after the other, each with a sample per worker
+	const std::vector<WorkerStatus> workers = active_workers();
+	const auto worker_labels = [](const WorkerStatus& worker)
+	{
+		return "{worker=\"" + std::to_string(worker.worker_id) + "\",file=\"" + escape_label_value(worker.file) + "\"} ";
+	};
+	append_header(text, "mesh_simplifier_worker_progress_percent", "gauge", "Progress of the file a worker simplifies.");
+	for (const WorkerStatus& worker : workers)
+	{
+		text += "mesh_simplifier_worker_progress_percent" + worker_labels(worker) + std::to_string(worker.percent) + "\n";
+	}
+	append_header(text, "mesh_simplifier_worker_elapsed_seconds", "gauge", "Time a worker has spent on its file.");
+	for (const WorkerStatus& worker : workers)
+	{
+		text += "mesh_simplifier_worker_elapsed_seconds" + worker_labels(worker) +
+			format_value(worker.elapsed_seconds) + "\n";
+	}
+	append_header(text, "mesh_simplifier_worker_eta_seconds", "gauge", "Estimated time left on a worker's file.");
+	for (const WorkerStatus& worker : workers)
+	{
+		if (0.0 <= worker.eta_seconds)
+		{
+			text += "mesh_simplifier_worker_eta_seconds" + worker_labels(worker) + format_value(worker.eta_seconds) + "\n";
+		}
+	}
+
+	append_header(text, "mesh_simplifier_resident_memory_bytes", "gauge", "Resident set size of the process.");
+	text += "mesh_simplifier_resident_memory_bytes " + std::to_string(resident_set_size()) + "\n";
+
+	return text;
+}
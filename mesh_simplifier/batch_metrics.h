@@ -0,0 +1,129 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "run_report.h"
+#include "stage_metrics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MetricCounter
+{
+public:
+	void increment(std::uint64_t amount = 1)
+	{
+		value_.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	std::uint64_t value() const
+	{
+		return value_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<std::uint64_t> value_{0};
+};
+
+class MetricGauge
+{
+public:
+	void set(std::int64_t value)
+	{
+		value_.store(value, std::memory_order_relaxed);
+	}
+
+	void add(std::int64_t amount)
+	{
+		value_.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	std::int64_t value() const
+	{
+		return value_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<std::int64_t> value_{0};
+};
+
+// cumulative histogram with fixed upper bounds, updated without locks.
+class MetricHistogram
+{
+public:
+	explicit MetricHistogram(std::vector<double> upper_bounds);
+
+	void observe(double value);
+
+	// prometheus text exposition of the buckets, sum and count, labels given as 'key="value"'.
+	std::string format(const std::string& name, const std::string& labels) const;
+
+private:
+	std::vector<double> upper_bounds_;
+	std::unique_ptr<std::atomic<std::uint64_t>[]> bucket_counts_;
+	std::atomic<std::uint64_t> count_{0};
+	std::atomic<double> sum_{0.0};
+};
+
+// counters, histograms and gauges of a batch run, exported as a node-exporter textfile, with the progress of
+// every worker inside a ProgressScope at the time of writing.
+class BatchMetrics
+{
+public:
+	BatchMetrics();
+
+	void file_started();
+	void file_finished(const FileRecord& record);
+
+	// rewrites the textfile atomically (write to a temporary file, then rename over the old one).
+	// safe to call from the worker threads.
+	bool write_textfile(const std::filesystem::path& textfile_path) const;
+
+private:
+	std::string format() const;
+
+	mutable std::mutex textfile_mutex_;
+
+	MetricCounter files_succeeded_;
+	MetricCounter files_failed_import_;
+	MetricCounter files_failed_simplify_;
+	MetricCounter files_failed_export_;
+	MetricCounter files_failed_overrides_;
+	MetricCounter files_failed_deviation_;
+	MetricCounter files_failed_clean_check_;
+	// interrupted before any stage ran
+	MetricCounter files_cancelled_;
+	MetricCounter faces_in_;
+	MetricCounter faces_out_;
+
+	std::vector<std::unique_ptr<MetricHistogram>> stage_seconds_;
+	MetricHistogram faces_per_second_;
+
+	MetricGauge active_workers_;
+};
@@ -20,13 +20,19 @@
 *                                                                           *
 ****************************************************************************/
 
-#include <common/globals.h>
+#include "allocator.h"
+#include "async_appender.h"
+#include "batch_metrics.h"
+#include "parameter_overrides.h"
+#include "perf_counters.h"
+#include "point_cloud.h"
+#include "progress.h"
+#include "run_report.h"
+#include "simplifier_engine.h"
+#include "stage_metrics.h"
+#include "trace_writer.h"
+
 #include <common/mlapplication.h>
-#include <common/mlexception.h>
-#include <common/filterscript.h>
-#include <common/parameters/rich_parameter_list.h>
-#include <common/plugins/plugin_manager.h>
-#include <common/utilities/load_save.h>
 
 #include <dimcli/cli.h>
 
@@ -36,13 +42,12 @@
 #include <log4cpp/OstreamAppender.hh>
 #include <log4cpp/PatternLayout.hh>
 
-#include <QDir>
-#include <QFileInfo>
 #include <QElapsedTimer>
 #include <QGLFormat>
 
 #include <clocale>
 #include <filesystem>
+#include <memory>
 #include <stdlib.h>
 
 bool compare_case_insensitive(std::string& lhs, std::string& rhs)
@@ -53,191 +58,6 @@ bool compare_case_insensitive(std::string& lhs, std::string& rhs)
 	}));
 }
 
-bool export_mesh(QString output_file_path, PluginManager& plugin_manager, MeshDocument& mesh_document,
-                 int texture_quality)
-{
-	bool saved = true;
-	if (output_file_path.isEmpty())
-	{
-		return false;
-	}
-
-	//save path away so we can use it again
-	QString output_directory_path = output_file_path;
-	output_directory_path.truncate(output_file_path.lastIndexOf("/"));
-
-	QString extension = output_file_path;
-	extension.remove(0, output_file_path.lastIndexOf('.') + 1);
-
-	IOPlugin* p_io_plugin = plugin_manager.outputMeshPlugin(extension);
-	if (p_io_plugin == nullptr)
-	{
-		return false;
-	}
-	p_io_plugin->setLog(&mesh_document.Log);
-
-	MeshModel* p_mesh_model = mesh_document.mm();
-
-	int capability = 0;
-	int default_bits = 0;
-	p_io_plugin->exportMaskCapability(extension, capability, default_bits);
-	const RichParameterList save_parameters = p_io_plugin->initSaveParameter(extension, *p_mesh_model);
-
-	try
-	{
-		const int mask = 4368;
-		p_io_plugin->save(extension, output_file_path, *p_mesh_model, mask, save_parameters, nullptr);
-		p_mesh_model->saveTextures(output_directory_path, texture_quality);
-
-		return true;
-	}
-	catch (const MLException& e)
-	{
-		return false;
-	}
-}
-
-bool import_mesh(QString input_file_name, PluginManager& plugin_manager, MeshDocument& mesh_document)
-{
-	QStringList file_names;
-	file_names.push_back(input_file_name);
-	if (file_names.isEmpty())
-	{
-		return false;
-	}
-
-	QElapsedTimer total_time;
-	total_time.start();
-
-	for (const QString& file_name : file_names)
-	{
-		QFileInfo file_info(file_name);
-		if (!file_info.exists())
-		{
-			//QString error_msg_format = "Unable to open file:\n\"%1\"\n\nError details: file %1 does not exist.";
-
-			return false;
-		}
-		if (!file_info.isReadable())
-		{
-			//QString error_msg_format = "Unable to open file:\n\"%1\"\n\nError details: file %1 is not readable.";
-
-			return false;
-		}
-
-		QString extension = file_info.suffix();
-		IOPlugin* p_io_plugin = plugin_manager.inputMeshPlugin(extension);
-
-		if (p_io_plugin == nullptr)
-		{
-			// QString error_msg_format("Unable to open file:\n\"%1\"\n\nError details: file format " + extension + " not supported.");
-
-			return false;
-		}
-
-		p_io_plugin->setLog(&mesh_document.Log);
-		RichParameterList pre_parameters = p_io_plugin->initPreOpenParameter(extension);
-
-		const unsigned int mesh_count = p_io_plugin->numberMeshesContainedInFile(extension, file_name, pre_parameters);
-		QFileInfo info(file_name);
-		std::list<MeshModel*> mesh_model_ptrs;
-		for (unsigned int i = 0; i < mesh_count; i++)
-		{
-			MeshModel* p_mesh_model = mesh_document.addNewMesh(file_name, info.fileName());
-			if (mesh_count != 1)
-			{
-				p_mesh_model->setIdInFile(i);
-			}
-			mesh_model_ptrs.push_back(p_mesh_model);
-		}
-
-		try
-		{
-			std::list<int> masks;
-			std::list<std::string> unloaded_textures = meshlab::loadMesh(
-				file_name, p_io_plugin, pre_parameters, mesh_model_ptrs, masks, nullptr);
-		}
-		catch (const MLException& e)
-		{
-			for (MeshModel* p_mesh_model : mesh_model_ptrs)
-			{
-				mesh_document.delMesh(p_mesh_model);
-			}
-		}
-	}
-
-	return true;
-}
-
-RichParameterList build_simplification_parameters(MeshModel const& mesh_model, float target_face_ratio,
-                                                  float quality_threshold)
-{
-	RichParameterList result;
-
-	result.addParam(RichInt("TargetFaceNum",
-	                        (0 < mesh_model.cm.sfn)
-		                        ? mesh_model.cm.sfn * target_face_ratio
-		                        : mesh_model.cm.fn * target_face_ratio, "Target number of faces",
-	                        "The desired final number of faces."));
-	result.addParam(RichFloat("TargetPerc", 0, "Percentage reduction (0..1)",
-	                          "If non zero, this parameter specifies the desired final size of the mesh as a percentage of the initial size."));
-	result.addParam(RichFloat("QualityThr", quality_threshold, "Quality threshold",
-	                          "Quality threshold for penalizing bad shaped faces.<br>The value is in the range [0..1]\n 0 accept any kind of face (no penalties),\n 0.5  penalize faces with quality < 0.5, proportionally to their shape\n"));
-	result.addParam(RichBool("PreserveBoundary", true, "Preserve Boundary of the mesh",
-	                         "The simplification process tries to do not affect mesh boundaries during simplification"));
-	result.addParam(RichFloat("BoundaryWeight", 1.0, "Boundary Preserving Weight",
-	                          "The importance of the boundary during simplification. Default (1.0) means that the boundary has the same importance of the rest. Values greater than 1.0 raise boundary importance and has the effect of removing less vertices on the border. Admitted range of values (0,+inf). "));
-	result.addParam(RichBool("PreserveNormal", false, "Preserve Normal",
-	                         "Try to avoid face flipping effects and try to preserve the original orientation of the surface"));
-	result.addParam(RichBool("PreserveTopology", false, "Preserve Topology",
-	                         "Avoid all the collapses that should cause a topology change in the mesh (like closing holes, squeezing handles, etc). If checked the genus of the mesh should stay unchanged."));
-	result.addParam(RichBool("OptimalPlacement", true, "Optimal position of simplified vertices",
-	                         "Each collapsed vertex is placed in the position minimizing the quadric error.\n It can fail (creating bad spikes) in case of very flat areas. \nIf disabled edges are collapsed onto one of the two original vertices and the final mesh is composed by a subset of the original vertices. "));
-	result.addParam(RichBool("PlanarQuadric", false, "Planar Simplification",
-	                         "Add additional simplification constraints that improves the quality of the simplification of the planar portion of the mesh, as a side effect, more triangles will be preserved in flat areas (allowing better shaped triangles)."));
-	result.addParam(RichFloat("PlanarWeight", 0.001, "Planar Simp. Weight",
-	                          "How much we should try to preserve the triangles in the planar regions. If you lower this value planar areas will be simplified more."));
-	result.addParam(RichBool("QualityWeight", false, "Weighted Simplification",
-	                         "Use the Per-Vertex quality as a weighting factor for the simplification. The weight is used as a error amplification value, so a vertex with a high quality value will not be simplified and a portion of the mesh with low quality values will be aggressively simplified."));
-	result.addParam(RichBool("AutoClean", true, "Post-simplification cleaning",
-	                         "After the simplification an additional set of steps is performed to clean the mesh (unreferenced vertices, bad faces, etc)"));
-	result.addParam(RichBool("Selected", mesh_model.cm.sfn > 0, "Simplify only selected faces",
-	                         "The simplification is applied only to the selected set of faces.\n Take care of the target number of faces!"));
-
-	return result;
-}
-
-bool filter_call_back(const int pos, const char* str)
-{
-	return true;
-}
-
-bool simplify(MeshDocument& mesh_document, const QAction* p_filter_action, RichParameterList& parameters)
-{
-	FilterPlugin* p_filter_plugin = qobject_cast<FilterPlugin*>(p_filter_action->parent());
-	p_filter_plugin->setLog(&mesh_document.Log);
-
-	try
-	{
-		mesh_document.meshDocStateData().clear();
-		mesh_document.meshDocStateData().create(mesh_document);
-
-		unsigned int post_condition_mask = MeshModel::MM_UNKNOWN;
-		p_filter_plugin->applyFilter(p_filter_action, parameters, mesh_document, post_condition_mask, filter_call_back);
-
-		mesh_document.meshDocStateData().clear();
-
-		return true;
-	}
-	catch (const std::bad_alloc& exception)
-	{
-		return false;
-	} catch (const MLException& exception)
-	{
-		return false;
-	}
-}
-
 std::filesystem::path calculate_plugin_directory_path(std::string executable_path)
 {
 	auto plugin_directory_path = weakly_canonical(std::filesystem::path(executable_path)).parent_path();
@@ -251,18 +71,26 @@ std::filesystem::path calculate_plugin_directory_path(std::string executable_pat
 	return absolute(plugin_directory_path);
 }
 
-void load_plugins(std::filesystem::path plugin_directory_path, MeshLabApplication& app, PluginManager& plugin_manager)
+SimplificationSettings simplification_settings(const SimplifyOptions& options,
+                                               const std::vector<std::string>& override_sources)
 {
-	try
-	{
-		const QDir plugin_directory_as_qdir(QString::fromUtf8((plugin_directory_path.generic_string().c_str())));
-		
-		app.addLibraryPath(plugin_directory_as_qdir.absolutePath());
-		plugin_manager.loadPlugins(plugin_directory_as_qdir);
-	}
-	catch (const MLException& e)
-	{
-	}
+	SimplificationSettings settings;
+	settings.target_face_ratio = options.target_face_ratio;
+	settings.quality_threshold = options.quality_threshold;
+	settings.texture_quality = options.texture_quality;
+	settings.preserve_boundary = options.preserve_boundary;
+	settings.boundary_weight = options.boundary_weight;
+	settings.preserve_normal = options.preserve_normal;
+	settings.preserve_topology = options.preserve_topology;
+	settings.optimal_placement = options.optimal_placement;
+	settings.planar_quadric = options.planar_quadric;
+	settings.planar_weight = options.planar_weight;
+	settings.quality_weight = options.quality_weight;
+	settings.auto_clean = options.auto_clean;
+	settings.deadline_seconds = options.deadline_seconds;
+	settings.override_sources = override_sources;
+
+	return settings;
 }
 
 int main(int argc, char* argv[])
@@ -295,15 +123,104 @@ int main(int argc, char* argv[])
 	auto& texture_quality_parameter = cli.opt<int>("t", 50).clamp(0, 100).desc("texture quality.");
 	auto& mesh_quality_parameter = cli.opt<int>("m", 30).clamp(1, 100).desc("mesh quality.");
 	auto& target_face_ratio_parameter = cli.opt<int>("f", 30).clamp(1, 100).desc("target face ratio.");
+	auto& report_format_parameter = cli.opt<std::string>("report", "").desc(
+		"write a run report beside the output root directory (json or csv).").check([](auto& cli, auto& opt, auto& val)
+	{
+		return (*opt).empty() || *opt == "json" || *opt == "csv" || cli.badUsage("report must be json or csv.");
+	});
+	auto& trace_file_path_parameter = cli.opt<std::string>("trace", "").desc(
+		"write a chrome trace-event json of the processing timeline to this path.");
+	auto& metrics_file_path_parameter = cli.opt<std::string>("metrics", "").desc(
+		"keep a prometheus node-exporter textfile with batch metrics at this path.");
+	auto& deadline_parameter = cli.opt<int>("deadline", 0).clamp(0, 86400).desc(
+		"cancel the simplification of a file after this many seconds (0 = no deadline).");
+	auto& perf_counters_parameter = cli.opt<bool>("perf-counters", false).desc(
+		"count cycles, instructions, cache and branch misses and page faults per stage, on the thread running it.");
+	auto& huge_pages_parameter = cli.opt<bool>("huge-pages", false).desc(
+		"back large allocations with huge pages (mimalloc builds only).");
+	auto& overrides_file_path_parameter = cli.opt<std::string>("overrides", "").desc(
+		"json file with per-file option overrides by glob, applied before each model's .simplify.json sidecar.");
+	auto& mesh_cache_directory_path_parameter = cli.opt<std::string>("mesh-cache", "").desc(
+		"directory of binary copies of imported meshes; repeat imports of unchanged inputs map them instead.");
+	auto& engine_parameter = cli.opt<std::string>("engine", "filter").desc(
+		"edge collapse implementation (filter, quadric or random).").check([](auto& cli, auto& opt, auto& val)
+	{
+		return *opt == "filter" || *opt == "quadric" || *opt == "random" ||
+			cli.badUsage("engine must be filter, quadric or random.");
+	});
+	auto& memoryless_parameter = cli.opt<bool>("memoryless", false).desc(
+		"quadric and random engines: measure collapses against the current faces instead of keeping quadrics.");
+	auto& decimation_threads_parameter = cli.opt<int>("decimation-threads", 1).clamp(0, 256).desc(
+		"threads per file for the engines' parallel phases and the cleanup after them (0 = one per hardware thread).");
+	auto& normal_weighting_parameter = cli.opt<std::string>("normal-weighting", "area").desc(
+		"weighting of the face normals in the exported vertex normals (area or angle).")
+		.check([](auto& cli, auto& opt, auto& val)
+	{
+		return *opt == "area" || *opt == "angle" || cli.badUsage("normal-weighting must be area or angle.");
+	});
+	auto& verify_clean_parameter = cli.opt<bool>("verify-clean", false).desc(
+		"filter engine: also run the filter's serial AutoClean on a copy and fail files the parallel cleanup changes.");
+	auto& instancing_parameter = cli.opt<bool>("instancing", false).desc(
+		"quadric and random engines: decimate each repeated component, within and across files, only once.");
+	auto& weld_parameter = cli.opt<double>("weld", 0.0).desc(
+		"weld vertices closer than this fraction of the bounding box diagonal before simplifying (0 = off).")
+		.check([](auto& cli, auto& opt, auto& val)
+	{
+		return (*opt >= 0.0 && *opt < 1.0) || cli.badUsage("weld must be at least 0 and below 1.");
+	});
+	auto& quadric_cache_parameter = cli.opt<bool>("quadric-cache", false).desc(
+		"keep the quadric engine's initial quadrics and collapse costs beside the mesh cache entries.");
+	auto& sweep_file_path_parameter = cli.opt<std::string>("sweep", "").desc(
+		"json parameter grid; every file is imported once and simplified per variant into <output>/<variant>.");
+	auto& sweep_threads_parameter = cli.opt<int>("sweep-threads", 0).clamp(0, 256).desc(
+		"variants simplified at once in a sweep with the quadric or random engine (0 = one per hardware thread); "
+		"filter variants run one at a time.");
+	auto& async_log_parameter = cli.opt<bool>("async-log", false).desc(
+		"write the log from a background thread instead of the logging thread.");
+	auto& log_overflow_parameter = cli.opt<std::string>("log-overflow", "block").desc(
+		"what an async log does when its queue is full (block or drop).").check([](auto& cli, auto& opt, auto& val)
+	{
+		return *opt == "block" || *opt == "drop" || cli.badUsage("log-overflow must be block or drop.");
+	});
 
 	if (!cli.parse(argc, argv))
 	{
 		return cli.printError(std::cerr);
 	}
 
+	const bool allocator_configured = configure_allocator(*huge_pages_parameter);
+
+	if (!(*trace_file_path_parameter).empty())
+	{
+		TraceWriter::instance().enable(1 << 16);
+	}
+
 	log4cpp::Category& category = log4cpp::Category::getInstance("main");
 	category.setPriority(log4cpp::Priority::INFO);
 
+	// category.shutdown() deletes the async appender, which flushes it
+	AsyncAppender* async_appender = nullptr;
+	if (*async_log_parameter)
+	{
+		const auto overflow_policy = *log_overflow_parameter == "drop"
+			                             ? AsyncAppender::OverflowPolicy::drop
+			                             : AsyncAppender::OverflowPolicy::block;
+		async_appender = new AsyncAppender("AsyncAppender", 1 << 14, overflow_policy);
+		AsyncAppender::install_crash_handlers();
+		category.addAppender(async_appender);
+	}
+	const auto add_appender = [&](log4cpp::Appender* appender)
+	{
+		if (async_appender != nullptr)
+		{
+			async_appender->addAppender(appender);
+		}
+		else
+		{
+			category.addAppender(appender);
+		}
+	};
+
 	{
 		std::filesystem::path log_file_path = *log_file_path_parameter;
 		log4cpp::Appender* appender = new log4cpp::FileAppender("RollingFileAppender", log_file_path.generic_string());//The first parameter is the name of appender, and the second is the name of the log file.
@@ -311,14 +228,14 @@ int main(int argc, char* argv[])
 		auto layout = new log4cpp::PatternLayout();
 		layout->setConversionPattern("[%p]%d{%d %b %Y %H:%M:%S.%l} %m %n");
 		appender->setLayout(layout);
-		category.addAppender(appender);
+		add_appender(appender);
 	}
 	{
 		log4cpp::Appender* appender = new log4cpp::OstreamAppender("ConsoleAppender", &std::cout);
 		auto layout = new log4cpp::PatternLayout();
 		layout->setConversionPattern("[%p]%d{%d %b %Y %H:%M:%S.%l} %m %n");
 		appender->setLayout(layout);
-		category.addAppender(appender);
+		add_appender(appender);
 	}
 
 	{
@@ -333,6 +250,18 @@ int main(int argc, char* argv[])
 
 		category.info(message);
 	}
+
+	{
+		std::string message = "allocator : ";
+		message += allocator_name();
+
+		category.info(message);
+
+		if (!allocator_configured)
+		{
+			category.warn("huge pages are not supported by the " + allocator_name() + " allocator");
+		}
+	}
 	
 	std::filesystem::path root_source_model_directory_path = *input_root_directory_path_parameter;
 	std::filesystem::path root_target_model_directory_path = *output_root_directory_path_parameter;
@@ -342,11 +271,52 @@ int main(int argc, char* argv[])
 	float mesh_quality = *mesh_quality_parameter / 100.0f;
 	float target_face_ratio = *target_face_ratio_parameter / 100.0f;
 
+	DecimationEngine decimation_engine = DecimationEngine::filter;
+	if (*engine_parameter == "quadric")
+	{
+		decimation_engine = DecimationEngine::quadric;
+	}
+	else if (*engine_parameter == "random")
+	{
+		decimation_engine = DecimationEngine::random;
+	}
+
+	ParameterOverrides parameter_overrides;
+	if (!(*overrides_file_path_parameter).empty())
+	{
+		std::string error;
+		if (!parameter_overrides.load(*overrides_file_path_parameter, decimation_engine, error))
+		{
+			category.error("unable to load overrides : " + error);
+			category.shutdown();
+
+			return 1;
+		}
+
+		category.info("overrides : " + std::to_string(parameter_overrides.rule_count()) + " rules from " +
+			*overrides_file_path_parameter);
+	}
+
+	std::vector<SweepVariant> sweep_variants;
+	if (!(*sweep_file_path_parameter).empty())
+	{
+		std::string error;
+		if (!load_sweep_grid(*sweep_file_path_parameter, decimation_engine, sweep_variants, error))
+		{
+			category.error("unable to load sweep grid : " + error);
+			category.shutdown();
+
+			return 1;
+		}
+
+		category.info("sweep : " + std::to_string(sweep_variants.size()) + " variants from " +
+			*sweep_file_path_parameter);
+	}
+
 	MeshLabApplication app(argc, argv);
 	std::setlocale(LC_ALL, "C");
 	QLocale::setDefault(QLocale::C);
 
-	PluginManager& plugin_manager = meshlab::pluginManagerInstance();
 	std::filesystem::path plugin_directory_path = calculate_plugin_directory_path(argv[0]);
 
 	{
@@ -356,7 +326,35 @@ int main(int argc, char* argv[])
 		category.info(message);
 	}
 
-	load_plugins(plugin_directory_path, app, plugin_manager);
+	SimplifierEngine engine(plugin_directory_path);
+	if (!(*mesh_cache_directory_path_parameter).empty())
+	{
+		engine.enable_mesh_cache(*mesh_cache_directory_path_parameter);
+
+		category.info("mesh cache : " + *mesh_cache_directory_path_parameter);
+	}
+	if (*quadric_cache_parameter)
+	{
+		if ((*mesh_cache_directory_path_parameter).empty())
+		{
+			category.warn("quadric cache ignored : it is kept beside the mesh cache, which is not enabled");
+		}
+		else
+		{
+			engine.enable_quadric_cache();
+		}
+	}
+	if (*instancing_parameter)
+	{
+		if (decimation_engine == DecimationEngine::filter)
+		{
+			category.warn("instancing ignored : the filter engine simplifies the mesh as a whole");
+		}
+		else
+		{
+			engine.enable_instance_library();
+		}
+	}
 
 	{
 		std::string message = "loading plugins ends : ";
@@ -364,8 +362,6 @@ int main(int argc, char* argv[])
 
 		category.info(message);
 	}
-	
-	QAction* p_filter_action = plugin_manager.filterAction("Simplification: Quadric Edge Collapse Decimation");
 
 	if (exists(root_target_model_directory_path))
 	{
@@ -373,6 +369,22 @@ int main(int argc, char* argv[])
 	}
 	create_directories(root_target_model_directory_path);
 
+	RunReport run_report;
+	// a sweep is only useful with its per-variant records, so it always writes a report
+	if (!(*report_format_parameter).empty() || !sweep_variants.empty())
+	{
+		const ReportFormat report_format = (*report_format_parameter == "json") ? ReportFormat::json : ReportFormat::csv;
+		const std::filesystem::path report_path = report_file_path(root_target_model_directory_path, report_format);
+
+		if (run_report.open(report_path, report_format))
+		{
+			category.info("run report : " + report_path.generic_string());
+		}
+		else
+		{
+			category.warn("unable to open run report : " + report_path.generic_string());
+		}
+	}
 
 	{
 		std::string message = "simplifying starts";
@@ -383,6 +395,75 @@ int main(int argc, char* argv[])
 	long success_count = 0;
 	long fail_count = 0;
 
+	install_interrupt_handler();
+
+	std::unique_ptr<PerfCounters> p_perf_counters;
+	PerfSummary perf_summary;
+	if (*perf_counters_parameter)
+	{
+		p_perf_counters = std::make_unique<PerfCounters>();
+		if (!p_perf_counters->available())
+		{
+			category.warn("performance counters are not available on this system");
+
+			p_perf_counters.reset();
+		}
+		else if (*decimation_threads_parameter != 1)
+		{
+			category.info("perf : counting the thread that runs each stage, not the decimation worker threads");
+		}
+	}
+
+	auto start_perf_counters = [&]()
+	{
+		if (p_perf_counters)
+		{
+			p_perf_counters->start();
+		}
+	};
+	auto stop_perf_counters = [&](const std::string& stage, const std::string& file)
+	{
+		if (p_perf_counters)
+		{
+			const PerfSample sample = p_perf_counters->stop();
+			perf_summary.add(stage, sample);
+
+			category.info("perf : stage=" + stage + " scope=thread file=" + file + " " + format_perf_sample(sample));
+		}
+	};
+
+	BatchMetrics batch_metrics;
+	const std::filesystem::path metrics_file_path = *metrics_file_path_parameter;
+
+	auto write_metrics = [&]()
+	{
+		if (!metrics_file_path.empty() && !batch_metrics.write_textfile(metrics_file_path))
+		{
+			category.warn("unable to write metrics : " + metrics_file_path.generic_string());
+		}
+	};
+	// written at the start of a file and on every progress line as well, so the active workers gauge and the
+	// per-worker progress are scraped while the file runs
+	auto start_file = [&]()
+	{
+		batch_metrics.file_started();
+		write_metrics();
+	};
+	// every processed file ends up here, whatever stage it stopped at
+	auto finish_file = [&](const FileRecord& file_record)
+	{
+		run_report.write(file_record);
+
+		batch_metrics.file_finished(file_record);
+		write_metrics();
+	};
+
+	RunMetrics run_metrics;
+	QElapsedTimer run_time;
+	run_time.start();
+
+	TraceSpan directory_walk_span("directory walk");
+
 	std::filesystem::recursive_directory_iterator source_model_iterator(root_source_model_directory_path);
 	for (const auto& entry : source_model_iterator)
 	{
@@ -391,78 +472,226 @@ int main(int argc, char* argv[])
 			continue;
 		}
 
+		if (interrupt_requested())
+		{
+			category.warn("simplifying interrupted");
+
+			break;
+		}
+
 		std::filesystem::path input_file_path = entry.path();
 		std::string input_file_extension = input_file_path.extension().string();
 		if (!compare_case_insensitive(input_file_extension, source_model_file_extension))
 		{
 			continue;
 		}
-		QString input_file_path_as_qstring = QString::fromUtf8(input_file_path.generic_string().c_str());
-
-		MeshDocument mesh_document;
-		if (!import_mesh(input_file_path_as_qstring, plugin_manager, mesh_document))
+		std::filesystem::path relative_file_path = relative(input_file_path, root_source_model_directory_path);
+		std::filesystem::path output_file_path = root_target_model_directory_path / relative_file_path;
+		// plys of points without faces are reduced as point clouds and stay plys
+		std::string point_cloud_extension = ".ply";
+		const bool point_cloud = compare_case_insensitive(input_file_extension, point_cloud_extension) &&
+			is_point_cloud_file(input_file_path);
+		auto model_file_path = output_file_path.replace_extension(point_cloud ? ".ply" : ".obj");
+
+		FileRecord file_record;
+		file_record.input_path = input_file_path.generic_string();
+
+		start_file();
+
+		SimplifyOptions simplify_options;
+		simplify_options.engine = decimation_engine;
+		simplify_options.memoryless = *memoryless_parameter;
+		simplify_options.decimation_threads = *decimation_threads_parameter;
+		simplify_options.normal_weighting = (*normal_weighting_parameter == "angle")
+			                                    ? NormalWeighting::angle
+			                                    : NormalWeighting::area;
+		simplify_options.verify_clean = *verify_clean_parameter;
+		simplify_options.instancing = *instancing_parameter;
+		simplify_options.weld_epsilon = *weld_parameter;
+		simplify_options.target_face_ratio = target_face_ratio;
+		simplify_options.quality_threshold = mesh_quality;
+		simplify_options.texture_quality = texture_quality;
+		simplify_options.deadline_seconds = *deadline_parameter;
+
+		std::vector<std::string> override_sources;
+		std::string override_error;
+		const bool overridden = parameter_overrides.resolve(input_file_path, relative_file_path.generic_string(),
+		                                                    simplify_options, override_sources, override_error);
+		file_record.settings = simplification_settings(simplify_options, override_sources);
+		if (!overridden)
 		{
 			++fail_count;
-			
+
 			std::string message = "simplification fail";
-			message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count)+ ")";
-			message += " - import error : ";
-			message += input_file_path.generic_string();
+			message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count) + ")";
+			message += " - overrides error : ";
+			message += input_file_path.generic_string() + " : " + override_error;
 
 			category.warn(message);
 
+			file_record.error_stage = "overrides";
+			finish_file(file_record);
+
 			continue;
 		}
+		if (!override_sources.empty())
+		{
+			std::string message = "overrides : file=" + input_file_path.generic_string() + " from";
+			for (const std::string& source : override_sources)
+			{
+				message += " [" + source + "]";
+			}
+
+			category.info(message);
+		}
 
-		MeshModel* p_mesh_model = mesh_document.mm();
-		RichParameterList simplification_parameters = build_simplification_parameters(
-			*p_mesh_model, target_face_ratio, mesh_quality);
-		if (!simplify(mesh_document, p_filter_action, simplification_parameters))
+		if (!sweep_variants.empty() && !point_cloud)
 		{
-			++fail_count;
+			std::vector<VariantJob> variant_jobs;
+			for (const SweepVariant& sweep_variant : sweep_variants)
+			{
+				VariantJob variant_job;
+				variant_job.name = sweep_variant.name;
+				variant_job.output_path = root_target_model_directory_path / sweep_variant.name / relative_file_path;
+				variant_job.output_path.replace_extension(".obj");
+				variant_job.options = simplify_options;
 
-			std::string message = "simplification fail";
-			message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count) + ")";
-			message += " - simplification error : ";
-			message += input_file_path.generic_string();
+				// validated when the grid was loaded
+				std::string error;
+				apply_option_overrides(sweep_variant.settings, variant_job.options, error);
 
-			category.warn(message);
+				variant_jobs.push_back(std::move(variant_job));
+			}
+
+			// stage hooks are left out: the variants run concurrently and the perf counters are per thread
+			SimplifyHooks sweep_hooks;
+			sweep_hooks.progress_log = [&](const std::string& message)
+			{
+				category.info(message);
+				write_metrics();
+			};
+
+			// the engine serializes the filter, so concurrent filter variants would only hold more mesh copies
+			const unsigned int sweep_threads = (decimation_engine == DecimationEngine::filter)
+				                                   ? 1
+				                                   : static_cast<unsigned int>(*sweep_threads_parameter);
+			const std::vector<VariantResult> variant_results = engine.simplify_variants(
+				input_file_path, variant_jobs, sweep_threads, sweep_hooks);
+			for (size_t i = 0; i < variant_results.size(); ++i)
+			{
+				const VariantJob& variant_job = variant_jobs[i];
+				const VariantResult& variant_result = variant_results[i];
+
+				// one record per variant, each balancing a start. the gauge counts the file once while it runs.
+				if (i != 0)
+				{
+					batch_metrics.file_started();
+				}
+
+				FileRecord variant_record = file_record;
+				variant_record.variant = variant_job.name;
+				variant_record.settings = simplification_settings(variant_job.options, override_sources);
+				variant_record.metrics = variant_result.result.metrics;
+				variant_record.output_path = variant_job.output_path.generic_string();
+				variant_record.error_stage = variant_result.result.error_stage;
+				variant_record.succeeded = variant_result.result.succeeded;
+				variant_record.max_deviation = variant_result.deviation.max_distance;
+				variant_record.mean_deviation = variant_result.deviation.mean_distance;
+
+				if (variant_record.succeeded)
+				{
+					++success_count;
+					run_metrics.add(variant_record.metrics);
+
+					category.info("sweep : file=" + input_file_path.generic_string() + " variant=" + variant_job.name +
+						" " + format_file_metrics(variant_record.metrics) + " max_deviation=" +
+						std::to_string(variant_record.max_deviation) + " mean_deviation=" +
+						std::to_string(variant_record.mean_deviation));
+				}
+				else
+				{
+					++fail_count;
+
+					category.warn("sweep : file=" + input_file_path.generic_string() + " variant=" + variant_job.name +
+						" failed at " + variant_record.error_stage);
+				}
+
+				finish_file(variant_record);
+			}
 
 			continue;
 		}
 
-		std::filesystem::path relative_file_path = relative(input_file_path, root_source_model_directory_path);
-		std::filesystem::path output_file_path = root_target_model_directory_path / relative_file_path;
-		std::filesystem::path output_directory_path = output_file_path.parent_path();
-		create_directories(output_directory_path);
-
-		auto obj_file_path = output_file_path.replace_extension(".obj");
-		QString output_file_path_as_qstring = QString::fromUtf8(obj_file_path.generic_string().c_str());
+		SimplifyHooks simplify_hooks;
+		simplify_hooks.stage_started = [&](const std::string& stage)
+		{
+			start_perf_counters();
+		};
+		simplify_hooks.stage_finished = [&](const std::string& stage)
+		{
+			stop_perf_counters(stage, file_record.input_path);
+		};
+		simplify_hooks.progress_log = [&](const std::string& message)
+		{
+			category.info(message);
+			write_metrics();
+		};
+
+		const SimplifyResult result = point_cloud
+			                              ? engine.simplify_point_cloud(input_file_path, model_file_path,
+			                                                            simplify_options, simplify_hooks)
+			                              : engine.simplify_file(input_file_path, model_file_path, simplify_options,
+			                                                     simplify_hooks);
+		file_record.metrics = result.metrics;
+		if (result.error_stage == "export")
+		{
+			file_record.output_path = model_file_path.generic_string();
+		}
 
-		if (!export_mesh(output_file_path_as_qstring, plugin_manager, mesh_document, texture_quality))
+		if (!result.succeeded)
 		{
 			++fail_count;
 
 			std::string message = "simplification fail";
 			message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count) + ")";
-			message += " - export error : ";
+			if (result.error_stage == "simplify")
+			{
+				message += result.cancel_reason.empty()
+					           ? " - simplification error : "
+					           : " - simplification " + result.cancel_reason + " : ";
+			}
+			else
+			{
+				message += " - " + result.error_stage + " error : ";
+			}
 			message += input_file_path.generic_string();
 
 			category.warn(message);
-		}
-		else
-		{
-			++success_count;
 
-			std::string message = "simplification success";
-			message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count) + ") : ";
-			message += input_file_path.generic_string();
-			message += " => ";
-			message += output_file_path.generic_string();
+			file_record.error_stage = result.error_stage;
+			finish_file(file_record);
 
-			category.info(message);
+			continue;
 		}
-		
+
+		++success_count;
+
+		std::string message = "simplification success";
+		message += "(" + std::to_string(fail_count) + "/" + std::to_string(success_count) + ") : ";
+		message += input_file_path.generic_string();
+		message += " => ";
+		message += output_file_path.generic_string();
+
+		category.info(message);
+
+		run_metrics.add(result.metrics);
+
+		category.info("metrics : file=" + input_file_path.generic_string() + " " + format_file_metrics(result.metrics) +
+			(result.import_cached ? " import=cache" : ""));
+
+		file_record.output_path = model_file_path.generic_string();
+		file_record.succeeded = true;
+		finish_file(file_record);
 	}
 
 	{
@@ -470,6 +699,37 @@ int main(int argc, char* argv[])
 
 		category.info(message);
 	}
+
+	directory_walk_span.finish();
+
+	const double run_seconds = run_time.elapsed() / 1000.0;
+	for (const std::string& line : run_metrics.summary(run_seconds))
+	{
+		category.info("summary : " + line);
+	}
+	for (const std::string& line : perf_summary.summary())
+	{
+		category.info("summary : perf scope=thread " + line);
+	}
+	run_report.write_summary(success_count, fail_count, run_seconds, run_metrics);
+
+	if (TraceWriter::instance().enabled())
+	{
+		const std::filesystem::path trace_file_path = *trace_file_path_parameter;
+		if (TraceWriter::instance().write(trace_file_path))
+		{
+			category.info("trace : " + trace_file_path.generic_string());
+		}
+		else
+		{
+			category.warn("unable to write trace : " + trace_file_path.generic_string());
+		}
+	}
+
+	for (const std::string& line : allocator_statistics())
+	{
+		category.info("allocator statistics : " + line);
+	}
 	
 	category.shutdown();
 	
@@ -0,0 +1,265 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+#ifdef __linux__
+	// counts read together from the group leader: {nr, time_enabled, time_running, value[nr]}
+	constexpr std::uint64_t group_read_format =
+		PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	int open_perf_event(std::uint32_t type, std::uint64_t config, int group_leader)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = type;
+		attributes.config = config;
+		// only the leader is switched on and off, the members follow it
+		attributes.disabled = (group_leader < 0) ? 1 : 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = group_read_format;
+
+		// current thread, any cpu
+		return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group_leader, 0));
+	}
+#endif
+
+	std::uint64_t process_page_faults()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return counters.PageFaultCount;
+		}
+#endif
+		return 0;
+	}
+
+	std::string format_ratio(double numerator, double denominator)
+	{
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.3f", (0.0 < denominator) ? numerator / denominator : 0.0);
+
+		return buffer;
+	}
+}
+
+const char* perf_event_name(PerfEvent event)
+{
+	switch (event)
+	{
+	case PerfEvent::cycles:
+		return "cycles";
+	case PerfEvent::instructions:
+		return "instructions";
+	case PerfEvent::llc_misses:
+		return "llc_misses";
+	case PerfEvent::branch_misses:
+		return "branch_misses";
+	case PerfEvent::page_faults:
+		return "page_faults";
+	}
+
+	return "unknown";
+}
+
+PerfCounters::PerfCounters()
+{
+	file_descriptors_.fill(-1);
+
+#ifdef __linux__
+	// one group, so the events are scheduled onto the pmu together and their ratios hold even when the kernel
+	// multiplexes them. the first event that opens leads; an event that can not join is left out.
+	const std::pair<PerfEvent, std::pair<std::uint32_t, std::uint64_t>> events[] = {
+		{PerfEvent::cycles, {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}},
+		{PerfEvent::instructions, {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}},
+		{PerfEvent::llc_misses, {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}},
+		{PerfEvent::branch_misses, {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}},
+		{PerfEvent::page_faults, {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}},
+	};
+	for (const auto& [event, type_config] : events)
+	{
+		const int file_descriptor = open_perf_event(type_config.first, type_config.second, group_leader_);
+		if (file_descriptor < 0)
+		{
+			continue;
+		}
+
+		file_descriptors_[static_cast<size_t>(event)] = file_descriptor;
+		group_events_.push_back(event);
+		if (group_leader_ < 0)
+		{
+			group_leader_ = file_descriptor;
+		}
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+	for (const int file_descriptor : file_descriptors_)
+	{
+		if (0 <= file_descriptor)
+		{
+			close(file_descriptor);
+		}
+	}
+#endif
+}
+
+bool PerfCounters::available() const
+{
+#ifdef _WIN32
+	return true;
+#else
+	return 0 <= group_leader_;
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+	if (0 <= group_leader_)
+	{
+		ioctl(group_leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(group_leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+	start_page_faults_ = process_page_faults();
+}
+
+PerfSample PerfCounters::stop()
+{
+	PerfSample sample;
+
+#ifdef __linux__
+	if (group_leader_ < 0)
+	{
+		return sample;
+	}
+
+	ioctl(group_leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	std::vector<std::uint64_t> buffer(3 + group_events_.size());
+	const ssize_t size = static_cast<ssize_t>(buffer.size() * sizeof(std::uint64_t));
+	if (read(group_leader_, buffer.data(), size) != size || buffer[0] != group_events_.size())
+	{
+		return sample;
+	}
+
+	// scaled up to the whole interval when the group only ran for part of it
+	const std::uint64_t time_enabled = buffer[1];
+	const std::uint64_t time_running = buffer[2];
+	if (time_running == 0)
+	{
+		return sample;
+	}
+	const double scale = static_cast<double>(time_enabled) / time_running;
+	for (size_t i = 0; i < group_events_.size(); ++i)
+	{
+		const size_t event = static_cast<size_t>(group_events_[i]);
+		sample.values[event] = static_cast<std::uint64_t>(buffer[3 + i] * scale + 0.5);
+		sample.valid[event] = true;
+	}
+#elif defined(_WIN32)
+	const size_t page_faults = static_cast<size_t>(PerfEvent::page_faults);
+	sample.values[page_faults] = process_page_faults() - start_page_faults_;
+	sample.valid[page_faults] = true;
+#endif
+
+	return sample;
+}
+
+void PerfSummary::add(const std::string& stage, const PerfSample& sample)
+{
+	PerfSample& total = totals_[stage];
+	for (size_t i = 0; i < perf_event_count; ++i)
+	{
+		if (sample.valid[i])
+		{
+			total.values[i] += sample.values[i];
+			total.valid[i] = true;
+		}
+	}
+}
+
+std::vector<std::string> PerfSummary::summary() const
+{
+	std::vector<std::string> lines;
+	for (const auto& [stage, total] : totals_)
+	{
+		lines.push_back(stage + " " + format_perf_sample(total));
+	}
+
+	return lines;
+}
+
+std::string format_perf_sample(const PerfSample& sample)
+{
+	std::string result;
+	for (size_t i = 0; i < perf_event_count; ++i)
+	{
+		if (sample.valid[i])
+		{
+			result += (result.empty() ? "" : " ");
+			result += perf_event_name(static_cast<PerfEvent>(i));
+			result += "=" + std::to_string(sample.values[i]);
+		}
+	}
+
+	const double instructions = static_cast<double>(sample.value(PerfEvent::instructions));
+	if (sample.is_valid(PerfEvent::cycles) && sample.is_valid(PerfEvent::instructions))
+	{
+		result += " ipc=" + format_ratio(instructions, static_cast<double>(sample.value(PerfEvent::cycles)));
+	}
+	if (sample.is_valid(PerfEvent::instructions) && sample.is_valid(PerfEvent::llc_misses))
+	{
+		result += " llc_mpki=" + format_ratio(1000.0 * sample.value(PerfEvent::llc_misses), instructions);
+	}
+	if (sample.is_valid(PerfEvent::instructions) && sample.is_valid(PerfEvent::branch_misses))
+	{
+		result += " branch_mpki=" + format_ratio(1000.0 * sample.value(PerfEvent::branch_misses), instructions);
+	}
+
+	return result.empty() ? "unavailable" : result;
+}
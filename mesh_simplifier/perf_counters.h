@@ -0,0 +1,103 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+enum class PerfEvent
+{
+	cycles,
+	instructions,
+	llc_misses,
+	branch_misses,
+	page_faults,
+};
+
+constexpr size_t perf_event_count = 5;
+
+const char* perf_event_name(PerfEvent event);
+
+// event counts over one measured interval; events the platform could not count are marked invalid.
+struct PerfSample
+{
+	std::array<std::uint64_t, perf_event_count> values{};
+	std::array<bool, perf_event_count> valid{};
+
+	std::uint64_t value(PerfEvent event) const
+	{
+		return values[static_cast<size_t>(event)];
+	}
+
+	bool is_valid(PerfEvent event) const
+	{
+		return valid[static_cast<size_t>(event)];
+	}
+};
+
+// hardware and software counters of the calling thread only, via perf_event_open on linux: the worker threads
+// of the parallel phases are not counted. the events form one group, read with their enabled and running times
+// and scaled when the kernel had to multiplex them.
+// elsewhere, or when the kernel refuses (perf_event_paranoid, containers, vms), only what the os
+// reports per process is counted (page faults on windows) and the rest stays invalid.
+class PerfCounters
+{
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// false when not a single event can be counted
+	bool available() const;
+
+	void start();
+	PerfSample stop();
+
+private:
+	std::array<int, perf_event_count> file_descriptors_;
+	int group_leader_ = -1;
+	// the events of the group, in the order a group read returns them
+	std::vector<PerfEvent> group_events_;
+	std::uint64_t start_page_faults_ = 0;
+};
+
+// totals per pipeline stage over a run.
+class PerfSummary
+{
+public:
+	void add(const std::string& stage, const PerfSample& sample);
+
+	std::vector<std::string> summary() const;
+
+private:
+	std::map<std::string, PerfSample> totals_;
+};
+
+// "cycles=... instructions=... ipc=..." for a single sample, invalid events are skipped.
+std::string format_perf_sample(const PerfSample& sample);
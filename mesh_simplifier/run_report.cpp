@@ -0,0 +1,287 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "run_report.h"
+
+#include "json_string.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	std::string escape_csv(const std::string& value)
+	{
+		if (value.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			return value;
+		}
+
+		std::string result = "\"";
+		for (const char c : value)
+		{
+			if (c == '"')
+			{
+				result += '"';
+			}
+			result += c;
+		}
+		result += '"';
+
+		return result;
+	}
+
+	std::string format_number(double value)
+	{
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+
+		return buffer;
+	}
+
+	std::string format_bool(bool value)
+	{
+		return value ? "true" : "false";
+	}
+
+	std::string join(const std::vector<std::string>& values, const std::string& separator)
+	{
+		std::string result;
+		for (const std::string& value : values)
+		{
+			result += (result.empty() ? "" : separator) + value;
+		}
+
+		return result;
+	}
+
+	// ordered (key, value) pairs of a record; values are already formatted, strings are not yet escaped.
+	struct Field
+	{
+		std::string key;
+		std::string value;
+		bool is_string;
+	};
+
+	std::vector<Field> file_record_fields(const FileRecord& record)
+	{
+		std::vector<Field> fields = {
+			{"record", "file", true},
+			{"input_path", record.input_path, true},
+			{"output_path", record.output_path, true},
+			{"status", record.succeeded ? "success" : "fail", true},
+			{"error_stage", record.error_stage, true},
+			{"variant", record.variant, true},
+			{"target_face_ratio", format_number(record.settings.target_face_ratio), false},
+			{"quality_threshold", format_number(record.settings.quality_threshold), false},
+			{"texture_quality", std::to_string(record.settings.texture_quality), false},
+			{"preserve_boundary", format_bool(record.settings.preserve_boundary), false},
+			{"boundary_weight", format_number(record.settings.boundary_weight), false},
+			{"preserve_normal", format_bool(record.settings.preserve_normal), false},
+			{"preserve_topology", format_bool(record.settings.preserve_topology), false},
+			{"optimal_placement", format_bool(record.settings.optimal_placement), false},
+			{"planar_quadric", format_bool(record.settings.planar_quadric), false},
+			{"planar_weight", format_number(record.settings.planar_weight), false},
+			{"quality_weight", format_bool(record.settings.quality_weight), false},
+			{"auto_clean", format_bool(record.settings.auto_clean), false},
+			{"deadline_seconds", format_number(record.settings.deadline_seconds), false},
+			{"overrides", join(record.settings.override_sources, ";"), true},
+			{"vertices_in", std::to_string(record.metrics.vertices_in), false},
+			{"vertices_out", std::to_string(record.metrics.vertices_out), false},
+			{"faces_in", std::to_string(record.metrics.faces_in), false},
+			{"faces_out", std::to_string(record.metrics.faces_out), false},
+			{"bytes_in", std::to_string(record.metrics.bytes_in), false},
+			{"bytes_out", std::to_string(record.metrics.bytes_out), false},
+			{"max_deviation", format_number(record.max_deviation), false},
+			{"mean_deviation", format_number(record.mean_deviation), false},
+		};
+
+		for (size_t i = 0; i < stage_count; ++i)
+		{
+			fields.push_back({std::string(stage_name(static_cast<Stage>(i))) + "_s",
+			                  format_number(record.metrics.stage_seconds[i]), false});
+		}
+		fields.push_back({"peak_rss", std::to_string(record.metrics.peak_rss), false});
+
+		return fields;
+	}
+
+	// comma separated "key":value members of a json object, without the braces
+	std::string json_members(const std::vector<Field>& fields)
+	{
+		std::string result;
+		for (const Field& field : fields)
+		{
+			result += result.empty() ? "" : ",";
+			result += to_json_string(field.key) + ":" + (field.is_string ? to_json_string(field.value) : field.value);
+		}
+
+		return result;
+	}
+
+	std::string csv_row(const std::vector<Field>& fields)
+	{
+		std::string result;
+		for (const Field& field : fields)
+		{
+			result += (result.empty() ? "" : ",") + escape_csv(field.value);
+		}
+
+		return result;
+	}
+}
+
+bool RunReport::open(const std::filesystem::path& report_file_path, ReportFormat format)
+{
+	format_ = format;
+	summary_file_path_ = report_file_path;
+	summary_file_path_.replace_extension(".summary.csv");
+	stream_.open(report_file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!stream_.is_open())
+	{
+		return false;
+	}
+
+	if (format_ == ReportFormat::csv)
+	{
+		std::string header;
+		for (const Field& field : file_record_fields(FileRecord()))
+		{
+			header += (header.empty() ? "" : ",") + field.key;
+		}
+		stream_ << header << '\n';
+		stream_.flush();
+	}
+
+	return true;
+}
+
+bool RunReport::is_open() const
+{
+	return stream_.is_open();
+}
+
+void RunReport::write(const FileRecord& record)
+{
+	if (!is_open())
+	{
+		return;
+	}
+
+	const std::vector<Field> fields = file_record_fields(record);
+	if (format_ == ReportFormat::json)
+	{
+		stream_ << "{" << json_members(fields) << "}\n";
+	}
+	else
+	{
+		stream_ << csv_row(fields) << '\n';
+	}
+	stream_.flush();
+}
+
+void RunReport::write_summary(long success_count, long fail_count, double wall_seconds, const RunMetrics& run_metrics)
+{
+	if (!is_open())
+	{
+		return;
+	}
+
+	const std::vector<Field> fields = {
+		{"record", "summary", true},
+		{"success_count", std::to_string(success_count), false},
+		{"fail_count", std::to_string(fail_count), false},
+		{"wall_s", format_number(wall_seconds), false},
+		{"faces_in", std::to_string(run_metrics.faces_in()), false},
+		{"faces_out", std::to_string(run_metrics.faces_out()), false},
+		{"bytes_in", std::to_string(run_metrics.bytes_in()), false},
+		{"bytes_out", std::to_string(run_metrics.bytes_out()), false},
+		{"peak_rss", std::to_string(run_metrics.peak_rss()), false},
+	};
+
+	if (format_ == ReportFormat::json)
+	{
+		std::string line = "{" + json_members(fields);
+
+		line += ",\"stages\":{";
+		for (size_t i = 0; i < stage_count; ++i)
+		{
+			const Stage stage = static_cast<Stage>(i);
+
+			line += (i == 0) ? "" : ",";
+			line += to_json_string(stage_name(stage)) + ":{";
+			line += "\"total_s\":" + format_number(run_metrics.stage_total_seconds(stage));
+			line += ",\"p50_s\":" + format_number(run_metrics.stage_percentile(stage, 0.50));
+			line += ",\"p95_s\":" + format_number(run_metrics.stage_percentile(stage, 0.95));
+			line += ",\"p99_s\":" + format_number(run_metrics.stage_percentile(stage, 0.99));
+			line += "}";
+		}
+		line += "}}";
+
+		stream_ << line << '\n';
+		stream_.flush();
+	}
+	else
+	{
+		// the csv columns are those of a file record, so the summary is a table of its own
+		std::ofstream summary_stream(summary_file_path_, std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!summary_stream.is_open())
+		{
+			return;
+		}
+
+		std::string header;
+		for (const Field& field : fields)
+		{
+			header += (header.empty() ? "" : ",") + field.key;
+		}
+		std::string line = csv_row(fields);
+		for (size_t i = 0; i < stage_count; ++i)
+		{
+			const Stage stage = static_cast<Stage>(i);
+			const std::string name = stage_name(stage);
+
+			header += "," + name + "_total_s," + name + "_p50_s," + name + "_p95_s," + name + "_p99_s";
+			line += "," + format_number(run_metrics.stage_total_seconds(stage));
+			line += "," + format_number(run_metrics.stage_percentile(stage, 0.50));
+			line += "," + format_number(run_metrics.stage_percentile(stage, 0.95));
+			line += "," + format_number(run_metrics.stage_percentile(stage, 0.99));
+		}
+
+		summary_stream << header << '\n' << line << '\n';
+	}
+}
+
+std::filesystem::path report_file_path(const std::filesystem::path& output_root_directory_path, ReportFormat format)
+{
+	std::filesystem::path directory_path = output_root_directory_path.lexically_normal();
+	if (!directory_path.has_filename())
+	{
+		directory_path = directory_path.parent_path();
+	}
+
+	std::filesystem::path result = directory_path;
+	result += (format == ReportFormat::json) ? ".report.jsonl" : ".report.csv";
+
+	return result;
+}
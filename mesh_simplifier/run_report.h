@@ -0,0 +1,100 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "stage_metrics.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class ReportFormat
+{
+	json,
+	csv,
+};
+
+// simplification settings a file was processed with, after its overrides were applied.
+struct SimplificationSettings
+{
+	float target_face_ratio = 0.0f;
+	float quality_threshold = 0.0f;
+	int texture_quality = 0;
+
+	bool preserve_boundary = false;
+	float boundary_weight = 0.0f;
+	bool preserve_normal = false;
+	bool preserve_topology = false;
+	bool optimal_placement = false;
+	bool planar_quadric = false;
+	float planar_weight = 0.0f;
+	bool quality_weight = false;
+	bool auto_clean = false;
+	double deadline_seconds = 0.0;
+
+	// what the overrides came from, in the order they were applied, empty when none applied
+	std::vector<std::string> override_sources;
+};
+
+// outcome of processing one input file.
+struct FileRecord
+{
+	std::string input_path;
+	std::string output_path;
+
+	bool succeeded = false;
+	// stage that failed ("import", "simplify", "export", "overrides", "deviation" or "clean_check"), empty on success
+	std::string error_stage;
+	// parameter sweep variant, empty outside sweeps
+	std::string variant;
+
+	SimplificationSettings settings;
+	FileMetrics metrics;
+
+	// distances from the input to the simplified surface, measured in sweeps only
+	double max_deviation = 0.0;
+	double mean_deviation = 0.0;
+};
+
+// streams one record per processed file as json lines or csv, followed by a run summary record. the csv summary
+// has columns of its own and goes to a file of its own, <report>.summary.csv next to <report>.csv.
+// every record is flushed as soon as it is written so the report can be read while the run is going.
+class RunReport
+{
+public:
+	bool open(const std::filesystem::path& report_file_path, ReportFormat format);
+	bool is_open() const;
+
+	void write(const FileRecord& record);
+	void write_summary(long success_count, long fail_count, double wall_seconds, const RunMetrics& run_metrics);
+
+private:
+	std::ofstream stream_;
+	ReportFormat format_ = ReportFormat::json;
+	std::filesystem::path summary_file_path_;
+};
+
+// report file placed beside the output root, which is wiped at the start of each run.
+std::filesystem::path report_file_path(const std::filesystem::path& output_root_directory_path, ReportFormat format);
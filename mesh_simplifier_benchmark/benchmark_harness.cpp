@@ -0,0 +1,217 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "benchmark_harness.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	const char* const stage_keys[] = {"import", "simplify", "export_geometry", "export_textures"};
+
+	QString to_qstring(const std::filesystem::path& path)
+	{
+		return QString::fromUtf8(path.generic_string().c_str());
+	}
+
+	// the summary record is the last line of the simplifier's json run report, after one record per file
+	bool read_summary(const std::filesystem::path& report_file_path, CategoryResult& result, long& clean_check_fail_count)
+	{
+		clean_check_fail_count = 0;
+
+		QFile file(to_qstring(report_file_path));
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			return false;
+		}
+
+		QJsonObject summary;
+		while (!file.atEnd())
+		{
+			const QByteArray line = file.readLine().trimmed();
+			if (line.isEmpty())
+			{
+				continue;
+			}
+
+			const QJsonObject record = QJsonDocument::fromJson(line).object();
+			if (record.value("record").toString() == "summary")
+			{
+				summary = record;
+			}
+			else if (record.value("error_stage").toString() == "clean_check")
+			{
+				++clean_check_fail_count;
+			}
+		}
+		if (summary.isEmpty())
+		{
+			return false;
+		}
+
+		result.success_count = summary.value("success_count").toInt();
+		result.fail_count = summary.value("fail_count").toInt();
+		result.faces_in = static_cast<long long>(summary.value("faces_in").toDouble());
+		result.bytes_in = static_cast<std::uint64_t>(summary.value("bytes_in").toDouble());
+		result.bytes_out = static_cast<std::uint64_t>(summary.value("bytes_out").toDouble());
+		result.peak_rss = static_cast<std::uint64_t>(summary.value("peak_rss").toDouble());
+
+		const QJsonObject stages = summary.value("stages").toObject();
+		for (size_t i = 0; i < result.stage_seconds.size(); ++i)
+		{
+			result.stage_seconds[i] = stages.value(stage_keys[i]).toObject().value("total_s").toDouble();
+		}
+
+		return true;
+	}
+
+	bool run_once(const std::filesystem::path& category_directory_path, const HarnessOptions& options,
+	              CategoryResult& result, std::string& error_message)
+	{
+		const std::filesystem::path output_directory_path = options.work_directory_path / "output";
+		const std::filesystem::path log_file_path = options.work_directory_path / "log.txt";
+
+		QStringList arguments;
+		arguments << "-i" << to_qstring(category_directory_path);
+		arguments << "-o" << to_qstring(output_directory_path);
+		arguments << "-l" << to_qstring(log_file_path);
+		arguments << "-e" << ".obj";
+		arguments << "--report" << "json";
+		if (options.verify_clean)
+		{
+			arguments << "--verify-clean";
+		}
+		for (const std::string& argument : options.simplifier_arguments)
+		{
+			arguments << QString::fromStdString(argument);
+		}
+
+		QProcess process;
+		process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+		process.setStandardOutputFile(QProcess::nullDevice());
+
+		// the wall time includes plugin loading, as a batch run would
+		const auto start = std::chrono::steady_clock::now();
+		process.start(to_qstring(options.simplifier_path), arguments);
+		if (!process.waitForStarted(-1) || !process.waitForFinished(-1))
+		{
+			error_message = "unable to run " + options.simplifier_path.generic_string();
+
+			return false;
+		}
+		result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+		{
+			error_message = "simplifier failed on " + category_directory_path.generic_string();
+
+			return false;
+		}
+
+		std::filesystem::path report_file_path = output_directory_path;
+		report_file_path += ".report.jsonl";
+		long clean_check_fail_count = 0;
+		if (!read_summary(report_file_path, result, clean_check_fail_count))
+		{
+			error_message = "no run summary in " + report_file_path.generic_string();
+
+			return false;
+		}
+		if (clean_check_fail_count > 0)
+		{
+			// see the clean check lines of the log for which files
+			error_message = std::to_string(clean_check_fail_count) + " files failed the clean check in " +
+				category_directory_path.generic_string();
+
+			return false;
+		}
+
+		return true;
+	}
+}
+
+double CategoryResult::faces_per_second() const
+{
+	return (0.0 < wall_seconds) ? faces_in / wall_seconds : 0.0;
+}
+
+double CategoryResult::megabytes_per_second() const
+{
+	return (0.0 < wall_seconds) ? (bytes_in + bytes_out) / (1024.0 * 1024.0) / wall_seconds : 0.0;
+}
+
+std::vector<CategoryResult> run_benchmark(const std::filesystem::path& corpus_directory_path, const HarnessOptions& options,
+                                          std::vector<std::string>& error_messages)
+{
+	std::vector<std::filesystem::path> category_directory_paths;
+	for (const auto& entry : std::filesystem::directory_iterator(corpus_directory_path))
+	{
+		if (entry.is_directory())
+		{
+			category_directory_paths.push_back(entry.path());
+		}
+	}
+	std::sort(category_directory_paths.begin(), category_directory_paths.end());
+
+	std::filesystem::create_directories(options.work_directory_path);
+
+	std::vector<CategoryResult> results;
+	for (const std::filesystem::path& category_directory_path : category_directory_paths)
+	{
+		std::vector<CategoryResult> runs;
+		for (int i = 0; i < std::max(1, options.repeat_count); ++i)
+		{
+			CategoryResult run;
+			run.category = category_directory_path.filename().generic_string();
+
+			std::string error_message;
+			if (!run_once(category_directory_path, options, run, error_message))
+			{
+				error_messages.push_back(error_message);
+
+				break;
+			}
+			runs.push_back(run);
+		}
+		if (runs.empty())
+		{
+			continue;
+		}
+
+		std::sort(runs.begin(), runs.end(), [](const CategoryResult& lhs, const CategoryResult& rhs)
+		{
+			return lhs.wall_seconds < rhs.wall_seconds;
+		});
+		results.push_back(runs[runs.size() / 2]);
+	}
+
+	return results;
+}
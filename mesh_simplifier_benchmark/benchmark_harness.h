@@ -0,0 +1,67 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// outcome of running the simplifier over one corpus category.
+struct CategoryResult
+{
+	std::string category;
+
+	long success_count = 0;
+	long fail_count = 0;
+
+	double wall_seconds = 0.0;
+	// import, simplify, export geometry, export textures, summed over the files
+	std::array<double, 4> stage_seconds{};
+
+	long long faces_in = 0;
+	std::uint64_t bytes_in = 0;
+	std::uint64_t bytes_out = 0;
+	std::uint64_t peak_rss = 0;
+
+	double faces_per_second() const;
+	double megabytes_per_second() const;
+};
+
+struct HarnessOptions
+{
+	std::filesystem::path simplifier_path;
+	std::filesystem::path work_directory_path;
+	std::vector<std::string> simplifier_arguments;
+	int repeat_count = 3;
+	// runs the simplifier with --verify-clean and reports every category with a file that failed the check as an
+	// error
+	bool verify_clean = false;
+};
+
+// runs the simplifier executable on every category directory of the corpus, repeat_count times each,
+// and keeps the run with the median wall time. errors are appended to error_messages.
+std::vector<CategoryResult> run_benchmark(const std::filesystem::path& corpus_directory_path, const HarnessOptions& options,
+                                          std::vector<std::string>& error_messages);
@@ -0,0 +1,222 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "benchmark_report.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+#include <cstdio>
+
+namespace
+{
+	const char* const stage_keys[] = {"import", "simplify", "export_geometry", "export_textures"};
+
+	QString to_qstring(const std::filesystem::path& path)
+	{
+		return QString::fromUtf8(path.generic_string().c_str());
+	}
+
+	std::string format(const char* format_string, double value)
+	{
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), format_string, value);
+
+		return buffer;
+	}
+
+	// lower is better for times and memory, higher is better for throughput
+	void compare_metric(std::vector<MetricComparison>& comparisons, const std::string& category, const std::string& metric,
+	                    double baseline, double current, bool higher_is_better, double tolerance_percent)
+	{
+		if (baseline <= 0.0)
+		{
+			return;
+		}
+
+		MetricComparison comparison;
+		comparison.category = category;
+		comparison.metric = metric;
+		comparison.baseline = baseline;
+		comparison.current = current;
+		comparison.improvement_percent = (higher_is_better ? current - baseline : baseline - current) / baseline * 100.0;
+		comparison.regressed = comparison.improvement_percent < -tolerance_percent;
+
+		comparisons.push_back(comparison);
+	}
+}
+
+bool write_results(const std::filesystem::path& results_file_path, const std::vector<CategoryResult>& results)
+{
+	QJsonArray categories;
+	for (const CategoryResult& result : results)
+	{
+		QJsonObject stages;
+		for (size_t i = 0; i < result.stage_seconds.size(); ++i)
+		{
+			stages.insert(stage_keys[i], result.stage_seconds[i]);
+		}
+
+		QJsonObject category;
+		category.insert("category", QString::fromStdString(result.category));
+		category.insert("success_count", static_cast<double>(result.success_count));
+		category.insert("fail_count", static_cast<double>(result.fail_count));
+		category.insert("wall_s", result.wall_seconds);
+		category.insert("stages_s", stages);
+		category.insert("faces_in", static_cast<double>(result.faces_in));
+		category.insert("bytes_in", static_cast<double>(result.bytes_in));
+		category.insert("bytes_out", static_cast<double>(result.bytes_out));
+		category.insert("peak_rss", static_cast<double>(result.peak_rss));
+		category.insert("faces_per_s", result.faces_per_second());
+		category.insert("mb_per_s", result.megabytes_per_second());
+
+		categories.append(category);
+	}
+
+	QJsonObject root;
+	root.insert("version", 1);
+	root.insert("categories", categories);
+
+	QFile file(to_qstring(results_file_path));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		return false;
+	}
+
+	return file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) != -1;
+}
+
+bool read_results(const std::filesystem::path& results_file_path, std::vector<CategoryResult>& results)
+{
+	QFile file(to_qstring(results_file_path));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+	if (!document.isObject())
+	{
+		return false;
+	}
+
+	for (const QJsonValue& value : document.object().value("categories").toArray())
+	{
+		const QJsonObject category = value.toObject();
+
+		CategoryResult result;
+		result.category = category.value("category").toString().toStdString();
+		result.success_count = category.value("success_count").toInt();
+		result.fail_count = category.value("fail_count").toInt();
+		result.wall_seconds = category.value("wall_s").toDouble();
+		result.faces_in = static_cast<long long>(category.value("faces_in").toDouble());
+		result.bytes_in = static_cast<std::uint64_t>(category.value("bytes_in").toDouble());
+		result.bytes_out = static_cast<std::uint64_t>(category.value("bytes_out").toDouble());
+		result.peak_rss = static_cast<std::uint64_t>(category.value("peak_rss").toDouble());
+
+		const QJsonObject stages = category.value("stages_s").toObject();
+		for (size_t i = 0; i < result.stage_seconds.size(); ++i)
+		{
+			result.stage_seconds[i] = stages.value(stage_keys[i]).toDouble();
+		}
+
+		results.push_back(result);
+	}
+
+	return true;
+}
+
+std::vector<MetricComparison> compare_results(const std::vector<CategoryResult>& current,
+                                              const std::vector<CategoryResult>& baseline, double tolerance_percent)
+{
+	std::vector<MetricComparison> comparisons;
+	for (const CategoryResult& result : current)
+	{
+		for (const CategoryResult& baseline_result : baseline)
+		{
+			if (baseline_result.category != result.category)
+			{
+				continue;
+			}
+
+			const std::string& category = result.category;
+			compare_metric(comparisons, category, "wall_s", baseline_result.wall_seconds, result.wall_seconds, false,
+			               tolerance_percent);
+			for (size_t i = 0; i < result.stage_seconds.size(); ++i)
+			{
+				compare_metric(comparisons, category, std::string(stage_keys[i]) + "_s", baseline_result.stage_seconds[i],
+				               result.stage_seconds[i], false, tolerance_percent);
+			}
+			compare_metric(comparisons, category, "faces_per_s", baseline_result.faces_per_second(),
+			               result.faces_per_second(), true, tolerance_percent);
+			compare_metric(comparisons, category, "mb_per_s", baseline_result.megabytes_per_second(),
+			               result.megabytes_per_second(), true, tolerance_percent);
+			compare_metric(comparisons, category, "peak_rss", static_cast<double>(baseline_result.peak_rss),
+			               static_cast<double>(result.peak_rss), false, tolerance_percent);
+		}
+	}
+
+	return comparisons;
+}
+
+std::vector<std::string> format_results(const std::vector<CategoryResult>& results)
+{
+	std::vector<std::string> lines;
+	for (const CategoryResult& result : results)
+	{
+		std::string line = result.category;
+		line += " files=" + std::to_string(result.success_count) + "/" + std::to_string(result.success_count + result.fail_count);
+		line += " wall_s=" + format("%.3f", result.wall_seconds);
+		for (size_t i = 0; i < result.stage_seconds.size(); ++i)
+		{
+			line += " " + std::string(stage_keys[i]) + "_s=" + format("%.3f", result.stage_seconds[i]);
+		}
+		line += " faces_per_s=" + format("%.0f", result.faces_per_second());
+		line += " mb_per_s=" + format("%.2f", result.megabytes_per_second());
+		line += " peak_rss_mb=" + format("%.1f", result.peak_rss / (1024.0 * 1024.0));
+
+		lines.push_back(line);
+	}
+
+	return lines;
+}
+
+std::vector<std::string> format_comparisons(const std::vector<MetricComparison>& comparisons)
+{
+	std::vector<std::string> lines;
+	for (const MetricComparison& comparison : comparisons)
+	{
+		std::string line = comparison.regressed ? "REGRESSION " : "";
+		line += comparison.category + " " + comparison.metric;
+		line += " baseline=" + format("%.4g", comparison.baseline);
+		line += " current=" + format("%.4g", comparison.current);
+		line += " " + format("%+.1f", comparison.improvement_percent) + "%";
+
+		lines.push_back(line);
+	}
+
+	return lines;
+}
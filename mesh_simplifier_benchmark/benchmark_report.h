@@ -0,0 +1,53 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "benchmark_harness.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+bool write_results(const std::filesystem::path& results_file_path, const std::vector<CategoryResult>& results);
+bool read_results(const std::filesystem::path& results_file_path, std::vector<CategoryResult>& results);
+
+// one metric of one category measured against the baseline.
+struct MetricComparison
+{
+	std::string category;
+	std::string metric;
+	double baseline = 0.0;
+	double current = 0.0;
+	// positive means better
+	double improvement_percent = 0.0;
+	bool regressed = false;
+};
+
+// compares wall time, per-stage time, throughput and peak rss of the categories present in both runs.
+// a metric regresses when it is worse than the baseline by more than tolerance_percent.
+std::vector<MetricComparison> compare_results(const std::vector<CategoryResult>& current,
+                                              const std::vector<CategoryResult>& baseline, double tolerance_percent);
+
+std::vector<std::string> format_results(const std::vector<CategoryResult>& results);
+std::vector<std::string> format_comparisons(const std::vector<MetricComparison>& comparisons);
@@ -0,0 +1,601 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <utility>
+
+namespace
+{
+	constexpr double pi = 3.14159265358979323846;
+
+	// splitmix64: tiny, fast and identical on every platform, unlike the std distributions
+	class Random
+	{
+	public:
+		explicit Random(std::uint64_t seed)
+			: state_(seed)
+		{
+		}
+
+		std::uint64_t next()
+		{
+			std::uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+			return z ^ (z >> 31);
+		}
+
+		// uniform in [0, 1)
+		double uniform()
+		{
+			return (next() >> 11) * (1.0 / 9007199254740992.0);
+		}
+
+		double uniform(double low, double high)
+		{
+			return low + (high - low) * uniform();
+		}
+
+	private:
+		std::uint64_t state_;
+	};
+
+	std::uint64_t hash_lattice(std::int64_t x, std::int64_t y, std::int64_t z, std::uint64_t seed)
+	{
+		Random random(seed ^ (static_cast<std::uint64_t>(x) * 0x8da6b343ull) ^
+			(static_cast<std::uint64_t>(y) * 0xd8163841ull) ^ (static_cast<std::uint64_t>(z) * 0xcb1ab31full));
+
+		return random.next();
+	}
+
+	double lattice_value(std::int64_t x, std::int64_t y, std::int64_t z, std::uint64_t seed)
+	{
+		return (hash_lattice(x, y, z, seed) >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+	}
+
+	double smooth(double t)
+	{
+		return t * t * (3.0 - 2.0 * t);
+	}
+
+	// trilinearly interpolated value noise in [-1, 1]
+	double value_noise(double x, double y, double z, std::uint64_t seed)
+	{
+		const double fx = std::floor(x);
+		const double fy = std::floor(y);
+		const double fz = std::floor(z);
+		const auto ix = static_cast<std::int64_t>(fx);
+		const auto iy = static_cast<std::int64_t>(fy);
+		const auto iz = static_cast<std::int64_t>(fz);
+		const double tx = smooth(x - fx);
+		const double ty = smooth(y - fy);
+		const double tz = smooth(z - fz);
+
+		double corners[2][2][2];
+		for (int dz = 0; dz < 2; ++dz)
+		{
+			for (int dy = 0; dy < 2; ++dy)
+			{
+				for (int dx = 0; dx < 2; ++dx)
+				{
+					corners[dz][dy][dx] = lattice_value(ix + dx, iy + dy, iz + dz, seed);
+				}
+			}
+		}
+
+		auto lerp = [](double a, double b, double t)
+		{
+			return a + (b - a) * t;
+		};
+
+		const double y0 = lerp(lerp(corners[0][0][0], corners[0][0][1], tx), lerp(corners[0][1][0], corners[0][1][1], tx), ty);
+		const double y1 = lerp(lerp(corners[1][0][0], corners[1][0][1], tx), lerp(corners[1][1][0], corners[1][1][1], tx), ty);
+
+		return lerp(y0, y1, tz);
+	}
+
+	double fractal_noise(double x, double y, double z, int octaves, std::uint64_t seed)
+	{
+		double result = 0.0;
+		double amplitude = 0.5;
+		double frequency = 1.0;
+		for (int i = 0; i < octaves; ++i)
+		{
+			result += amplitude * value_noise(x * frequency, y * frequency, z * frequency, seed + i);
+			amplitude *= 0.5;
+			frequency *= 2.0;
+		}
+
+		return result;
+	}
+
+	std::array<float, 3> make_point(double x, double y, double z)
+	{
+		return {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+	}
+
+	// rows x columns quads of a regular grid, two triangles each
+	void append_grid_faces(GeneratedMesh& mesh, std::uint32_t first_vertex, size_t rows, size_t columns)
+	{
+		const auto stride = static_cast<std::uint32_t>(columns + 1);
+		for (size_t r = 0; r < rows; ++r)
+		{
+			for (size_t c = 0; c < columns; ++c)
+			{
+				const std::uint32_t v00 = first_vertex + static_cast<std::uint32_t>(r * stride + c);
+				const std::uint32_t v01 = v00 + 1;
+				const std::uint32_t v10 = v00 + stride;
+				const std::uint32_t v11 = v10 + 1;
+
+				mesh.faces.push_back({v00, v01, v11});
+				mesh.faces.push_back({v00, v11, v10});
+			}
+		}
+	}
+
+	GeneratedMesh generate_subdivided_sphere(size_t target_face_count)
+	{
+		GeneratedMesh mesh;
+
+		const double t = (1.0 + std::sqrt(5.0)) / 2.0;
+		const double icosahedron[12][3] = {
+			{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+			{0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+		};
+		for (const auto& p : icosahedron)
+		{
+			const double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			mesh.positions.push_back(make_point(p[0] / length, p[1] / length, p[2] / length));
+		}
+		mesh.faces = {
+			{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6},
+			{7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10},
+			{8, 6, 7}, {9, 8, 1},
+		};
+
+		while (mesh.faces.size() * 4 <= target_face_count * 2)
+		{
+			std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> midpoints;
+			auto midpoint = [&](std::uint32_t a, std::uint32_t b)
+			{
+				const auto key = std::minmax(a, b);
+				const auto found = midpoints.find(key);
+				if (found != midpoints.end())
+				{
+					return found->second;
+				}
+
+				const auto& pa = mesh.positions[a];
+				const auto& pb = mesh.positions[b];
+				const double x = (pa[0] + pb[0]) * 0.5;
+				const double y = (pa[1] + pb[1]) * 0.5;
+				const double z = (pa[2] + pb[2]) * 0.5;
+				const double length = std::sqrt(x * x + y * y + z * z);
+
+				const auto index = static_cast<std::uint32_t>(mesh.positions.size());
+				mesh.positions.push_back(make_point(x / length, y / length, z / length));
+				midpoints.emplace(key, index);
+
+				return index;
+			};
+
+			std::vector<std::array<std::uint32_t, 3>> faces;
+			faces.reserve(mesh.faces.size() * 4);
+			for (const auto& face : mesh.faces)
+			{
+				const std::uint32_t a = midpoint(face[0], face[1]);
+				const std::uint32_t b = midpoint(face[1], face[2]);
+				const std::uint32_t c = midpoint(face[2], face[0]);
+
+				faces.push_back({face[0], a, c});
+				faces.push_back({face[1], b, a});
+				faces.push_back({face[2], c, b});
+				faces.push_back({a, b, c});
+			}
+			mesh.faces = std::move(faces);
+		}
+
+		return mesh;
+	}
+
+	GeneratedMesh generate_noisy_terrain(size_t target_face_count, std::uint64_t seed)
+	{
+		GeneratedMesh mesh;
+
+		const size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(target_face_count / 2.0)));
+		for (size_t r = 0; r <= side; ++r)
+		{
+			for (size_t c = 0; c <= side; ++c)
+			{
+				const double x = static_cast<double>(c) / side;
+				const double y = static_cast<double>(r) / side;
+				const double height = 0.25 * fractal_noise(x * 4.0, y * 4.0, 0.0, 6, seed);
+
+				mesh.positions.push_back(make_point(x, y, height));
+			}
+		}
+		append_grid_faces(mesh, 0, side, side);
+
+		return mesh;
+	}
+
+	// closed blob with measurement noise and a few holes, like a raw range scan
+	GeneratedMesh generate_scan_surface(size_t target_face_count, std::uint64_t seed)
+	{
+		GeneratedMesh mesh;
+		Random random(seed);
+
+		const size_t rings = std::max<size_t>(4, static_cast<size_t>(std::sqrt(target_face_count / 4.0)));
+		const size_t segments = rings * 2;
+		for (size_t r = 0; r <= rings; ++r)
+		{
+			const double theta = pi * r / rings;
+			for (size_t s = 0; s <= segments; ++s)
+			{
+				const double phi = 2.0 * pi * (s % segments) / segments;
+				const double x = std::sin(theta) * std::cos(phi);
+				const double y = std::sin(theta) * std::sin(phi);
+				const double z = std::cos(theta);
+
+				const double radius = 1.0 + 0.2 * fractal_noise(x * 2.0 + 7.0, y * 2.0 + 7.0, z * 2.0 + 7.0, 4, seed) +
+					random.uniform(-0.002, 0.002);
+				mesh.positions.push_back(make_point(x * radius, y * radius, z * radius));
+			}
+		}
+		append_grid_faces(mesh, 0, rings, segments);
+
+		// occlusion holes: drop the faces whose first vertex falls within a few random caps
+		std::vector<std::array<double, 4>> holes;
+		for (int i = 0; i < 6; ++i)
+		{
+			const double theta = random.uniform(0.3, pi - 0.3);
+			const double phi = random.uniform(0.0, 2.0 * pi);
+			holes.push_back({std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta),
+				random.uniform(0.05, 0.15)});
+		}
+		mesh.faces.erase(std::remove_if(mesh.faces.begin(), mesh.faces.end(), [&](const std::array<std::uint32_t, 3>& face)
+		{
+			const auto& p = mesh.positions[face[0]];
+			const double length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+			for (const auto& hole : holes)
+			{
+				const double dx = p[0] / length - hole[0];
+				const double dy = p[1] / length - hole[1];
+				const double dz = p[2] / length - hole[2];
+				if (dx * dx + dy * dy + dz * dz < hole[3] * hole[3])
+				{
+					return true;
+				}
+			}
+			return false;
+		}), mesh.faces.end());
+
+		return mesh;
+	}
+
+	// tessellated cylinder of unit radius and height, capped at both ends
+	GeneratedMesh make_cylinder(size_t segments, size_t stacks)
+	{
+		GeneratedMesh part;
+		for (size_t k = 0; k <= stacks; ++k)
+		{
+			for (size_t s = 0; s <= segments; ++s)
+			{
+				const double phi = 2.0 * pi * (s % segments) / segments;
+				part.positions.push_back(make_point(std::cos(phi), std::sin(phi), static_cast<double>(k) / stacks));
+			}
+		}
+		append_grid_faces(part, 0, stacks, segments);
+
+		for (int cap = 0; cap < 2; ++cap)
+		{
+			const auto center = static_cast<std::uint32_t>(part.positions.size());
+			part.positions.push_back(make_point(0.0, 0.0, cap));
+
+			const auto ring = static_cast<std::uint32_t>(cap * stacks * (segments + 1));
+			for (size_t s = 0; s < segments; ++s)
+			{
+				const std::uint32_t a = ring + static_cast<std::uint32_t>(s);
+				const std::uint32_t b = a + 1;
+				if (cap == 0)
+				{
+					part.faces.push_back({center, b, a});
+				}
+				else
+				{
+					part.faces.push_back({center, a, b});
+				}
+			}
+		}
+
+		return part;
+	}
+
+	// unit box with every side split into n x n quads
+	GeneratedMesh make_box(size_t n)
+	{
+		GeneratedMesh part;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (int side = 0; side < 2; ++side)
+			{
+				const auto first_vertex = static_cast<std::uint32_t>(part.positions.size());
+				for (size_t r = 0; r <= n; ++r)
+				{
+					for (size_t c = 0; c <= n; ++c)
+					{
+						double p[3];
+						p[axis] = side;
+						p[(axis + 1) % 3] = static_cast<double>(side ? c : r) / n;
+						p[(axis + 2) % 3] = static_cast<double>(side ? r : c) / n;
+						part.positions.push_back(make_point(p[0], p[1], p[2]));
+					}
+				}
+				append_grid_faces(part, first_vertex, n, n);
+			}
+		}
+
+		return part;
+	}
+
+	// the same few parts repeated under random rigid transforms and uniform scales
+	GeneratedMesh generate_assembly(size_t target_face_count, std::uint64_t seed)
+	{
+		GeneratedMesh mesh;
+		Random random(seed);
+
+		const GeneratedMesh parts[] = {make_cylinder(24, 4), make_box(6), make_cylinder(8, 12)};
+
+		size_t part_index = 0;
+		while (mesh.faces.size() < target_face_count)
+		{
+			const GeneratedMesh& part = parts[part_index++ % 3];
+
+			const double angle = random.uniform(0.0, 2.0 * pi);
+			const double scale = random.uniform(0.5, 2.0);
+			const double offset[3] = {random.uniform(-50.0, 50.0), random.uniform(-50.0, 50.0), random.uniform(0.0, 10.0)};
+
+			const auto first_vertex = static_cast<std::uint32_t>(mesh.positions.size());
+			for (const auto& p : part.positions)
+			{
+				const double x = p[0] * std::cos(angle) - p[1] * std::sin(angle);
+				const double y = p[0] * std::sin(angle) + p[1] * std::cos(angle);
+				mesh.positions.push_back(make_point(x * scale + offset[0], y * scale + offset[1], p[2] * scale + offset[2]));
+			}
+			for (const auto& face : part.faces)
+			{
+				mesh.faces.push_back({face[0] + first_vertex, face[1] + first_vertex, face[2] + first_vertex});
+			}
+		}
+
+		return mesh;
+	}
+
+	// latitude/longitude sphere with an equirectangular parameterisation and its texture
+	GeneratedMesh generate_textured_model(size_t target_face_count, std::uint64_t seed)
+	{
+		GeneratedMesh mesh;
+
+		const size_t rings = std::max<size_t>(4, static_cast<size_t>(std::sqrt(target_face_count / 4.0)));
+		const size_t segments = rings * 2;
+		for (size_t r = 0; r <= rings; ++r)
+		{
+			const double theta = pi * r / rings;
+			for (size_t s = 0; s <= segments; ++s)
+			{
+				const double phi = 2.0 * pi * s / segments;
+				const double radius = 1.0 + 0.05 * fractal_noise(phi, theta, 0.0, 3, seed);
+
+				// the seam column is a separate vertex, as exported by DCC tools
+				mesh.positions.push_back(make_point(radius * std::sin(theta) * std::cos(phi),
+				                                    radius * std::sin(theta) * std::sin(phi), radius * std::cos(theta)));
+				mesh.texture_coordinates.push_back({static_cast<float>(static_cast<double>(s) / segments),
+					static_cast<float>(1.0 - static_cast<double>(r) / rings)});
+			}
+		}
+		append_grid_faces(mesh, 0, rings, segments);
+
+		mesh.face_texture_coordinates = mesh.faces;
+		mesh.texture_name = "checker.bmp";
+
+		return mesh;
+	}
+
+	bool write_checker_bmp(const std::filesystem::path& file_path, int size)
+	{
+		std::ofstream stream(file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!stream.is_open())
+		{
+			return false;
+		}
+
+		const std::uint32_t row_bytes = static_cast<std::uint32_t>(size) * 3;
+		const std::uint32_t image_bytes = row_bytes * size;
+		const std::uint32_t file_bytes = 54 + image_bytes;
+
+		auto put16 = [&](std::uint16_t value)
+		{
+			stream.put(static_cast<char>(value & 0xff)).put(static_cast<char>(value >> 8));
+		};
+		auto put32 = [&](std::uint32_t value)
+		{
+			put16(static_cast<std::uint16_t>(value & 0xffff));
+			put16(static_cast<std::uint16_t>(value >> 16));
+		};
+
+		stream.put('B').put('M');
+		put32(file_bytes);
+		put32(0);
+		put32(54);
+		put32(40);
+		put32(static_cast<std::uint32_t>(size));
+		put32(static_cast<std::uint32_t>(size));
+		put16(1);
+		put16(24);
+		put32(0);
+		put32(image_bytes);
+		put32(2835);
+		put32(2835);
+		put32(0);
+		put32(0);
+
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				const bool dark = ((x / 16) + (y / 16)) % 2 == 0;
+				stream.put(static_cast<char>(dark ? 40 : 220));
+				stream.put(static_cast<char>(dark ? 60 : 200));
+				stream.put(static_cast<char>(dark ? 90 : 180));
+			}
+		}
+
+		return stream.good();
+	}
+}
+
+const char* corpus_category_name(CorpusCategory category)
+{
+	switch (category)
+	{
+	case CorpusCategory::subdivided_sphere:
+		return "sphere";
+	case CorpusCategory::noisy_terrain:
+		return "terrain";
+	case CorpusCategory::scan_surface:
+		return "scan";
+	case CorpusCategory::assembly:
+		return "assembly";
+	case CorpusCategory::textured_model:
+		return "textured";
+	}
+
+	return "unknown";
+}
+
+GeneratedMesh generate_mesh(CorpusCategory category, size_t target_face_count, std::uint64_t seed)
+{
+	switch (category)
+	{
+	case CorpusCategory::subdivided_sphere:
+		return generate_subdivided_sphere(target_face_count);
+	case CorpusCategory::noisy_terrain:
+		return generate_noisy_terrain(target_face_count, seed);
+	case CorpusCategory::scan_surface:
+		return generate_scan_surface(target_face_count, seed);
+	case CorpusCategory::assembly:
+		return generate_assembly(target_face_count, seed);
+	case CorpusCategory::textured_model:
+		return generate_textured_model(target_face_count, seed);
+	}
+
+	return GeneratedMesh();
+}
+
+bool write_obj(const GeneratedMesh& mesh, const std::filesystem::path& directory_path, const std::string& name)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory_path, error);
+
+	const bool textured = !mesh.face_texture_coordinates.empty();
+	if (textured)
+	{
+		std::ofstream material_stream(directory_path / (name + ".mtl"), std::ios::out | std::ios::trunc);
+		material_stream << "newmtl material_0\nKa 1 1 1\nKd 1 1 1\nmap_Kd " << mesh.texture_name << "\n";
+		if (!material_stream.good() || !write_checker_bmp(directory_path / mesh.texture_name, 256))
+		{
+			return false;
+		}
+	}
+
+	std::FILE* p_file = std::fopen((directory_path / (name + ".obj")).string().c_str(), "wb");
+	if (p_file == nullptr)
+	{
+		return false;
+	}
+
+	if (textured)
+	{
+		std::fprintf(p_file, "mtllib %s.mtl\n", name.c_str());
+	}
+	for (const auto& p : mesh.positions)
+	{
+		std::fprintf(p_file, "v %.6f %.6f %.6f\n", p[0], p[1], p[2]);
+	}
+	for (const auto& t : mesh.texture_coordinates)
+	{
+		std::fprintf(p_file, "vt %.6f %.6f\n", t[0], t[1]);
+	}
+	if (textured)
+	{
+		std::fprintf(p_file, "usemtl material_0\n");
+	}
+	for (size_t i = 0; i < mesh.faces.size(); ++i)
+	{
+		const auto& f = mesh.faces[i];
+		if (textured)
+		{
+			const auto& t = mesh.face_texture_coordinates[i];
+			std::fprintf(p_file, "f %u/%u %u/%u %u/%u\n", f[0] + 1, t[0] + 1, f[1] + 1, t[1] + 1, f[2] + 1, t[2] + 1);
+		}
+		else
+		{
+			std::fprintf(p_file, "f %u %u %u\n", f[0] + 1, f[1] + 1, f[2] + 1);
+		}
+	}
+
+	const bool written = std::ferror(p_file) == 0;
+	std::fclose(p_file);
+
+	return written;
+}
+
+size_t generate_corpus(const std::filesystem::path& corpus_directory_path, int max_scale, std::uint64_t seed)
+{
+	// roughly ten thousand, a hundred thousand and a million faces
+	const size_t scale_face_counts[] = {10000, 100000, 1000000};
+
+	size_t file_count = 0;
+	for (size_t i = 0; i < corpus_category_count; ++i)
+	{
+		const auto category = static_cast<CorpusCategory>(i);
+		for (int scale = 1; scale <= std::clamp(max_scale, 1, 3); ++scale)
+		{
+			const GeneratedMesh mesh = generate_mesh(category, scale_face_counts[scale - 1], seed + i);
+			const std::string name = std::string(corpus_category_name(category)) + "_" + std::to_string(mesh.faces.size());
+			if (write_obj(mesh, corpus_directory_path / corpus_category_name(category), name))
+			{
+				++file_count;
+			}
+		}
+	}
+
+	return file_count;
+}
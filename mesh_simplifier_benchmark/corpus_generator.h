@@ -0,0 +1,66 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// triangle mesh as written to the benchmark corpus, optionally with per-wedge texture coordinates.
+struct GeneratedMesh
+{
+	std::vector<std::array<float, 3>> positions;
+	std::vector<std::array<std::uint32_t, 3>> faces;
+
+	std::vector<std::array<float, 2>> texture_coordinates;
+	// per face indices into texture_coordinates, empty for untextured meshes
+	std::vector<std::array<std::uint32_t, 3>> face_texture_coordinates;
+	std::string texture_name;
+};
+
+// corpus categories, each exercising a different kind of input.
+enum class CorpusCategory
+{
+	subdivided_sphere,
+	noisy_terrain,
+	scan_surface,
+	assembly,
+	textured_model,
+};
+
+constexpr size_t corpus_category_count = 5;
+
+const char* corpus_category_name(CorpusCategory category);
+
+// same seed and face budget always give the same mesh, on every platform.
+GeneratedMesh generate_mesh(CorpusCategory category, size_t target_face_count, std::uint64_t seed);
+
+// writes <directory>/<name>.obj, plus the material library and texture of textured meshes.
+bool write_obj(const GeneratedMesh& mesh, const std::filesystem::path& directory_path, const std::string& name);
+
+// writes <corpus>/<category>/<category>_<faces>.obj for every category and scale up to max_scale (1..3).
+// returns the number of files written.
+size_t generate_corpus(const std::filesystem::path& corpus_directory_path, int max_scale, std::uint64_t seed);
@@ -0,0 +1,138 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "benchmark_harness.h"
+#include "benchmark_report.h"
+#include "corpus_generator.h"
+
+#include <dimcli/cli.h>
+
+#include <QCoreApplication>
+
+#include <filesystem>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+	Dim::Cli cli;
+
+	auto& corpus_directory_path_parameter = cli.opt<std::string>("corpus").require().desc("benchmark corpus directory path.");
+	auto& generate_parameter = cli.opt<bool>("generate", false).desc("(re)generate the synthetic corpus first.");
+	auto& scale_parameter = cli.opt<int>("scale", 2).clamp(1, 3).desc(
+		"largest corpus scale to generate: 1 = 10k, 2 = 100k, 3 = 1M faces per model.");
+	auto& seed_parameter = cli.opt<int>("seed", 1).desc("corpus generator seed.");
+
+	auto& simplifier_path_parameter = cli.opt<std::string>("simplifier", "").desc(
+		"mesh_simplifier executable to benchmark; nothing is run without it.");
+	auto& simplifier_arguments_parameter = cli.optVec<std::string>("simplifier-arg").desc(
+		"extra argument passed to the simplifier, may be repeated.");
+	auto& work_directory_path_parameter = cli.opt<std::string>("work", "benchmark_work").desc(
+		"scratch directory for simplifier output and logs.");
+	auto& repeat_parameter = cli.opt<int>("repeat", 3).clamp(1, 100).desc("runs per category, the median is kept.");
+	auto& verify_clean_parameter = cli.opt<bool>("verify-clean", false).desc(
+		"check the simplifier's parallel cleanup against the filter's own AutoClean on every model.");
+
+	auto& results_file_path_parameter = cli.opt<std::string>("results", "benchmark_results.json").desc(
+		"where to write the results.");
+	auto& baseline_file_path_parameter = cli.opt<std::string>("baseline", "").desc(
+		"results of an earlier run to compare against.");
+	auto& tolerance_parameter = cli.opt<int>("tolerance", 10).clamp(0, 1000).desc(
+		"allowed slowdown against the baseline, in percent.");
+
+	if (!cli.parse(argc, argv))
+	{
+		return cli.printError(std::cerr);
+	}
+
+	QCoreApplication app(argc, argv);
+
+	const std::filesystem::path corpus_directory_path = *corpus_directory_path_parameter;
+	if (*generate_parameter)
+	{
+		std::filesystem::remove_all(corpus_directory_path);
+
+		const size_t file_count = generate_corpus(corpus_directory_path, *scale_parameter,
+		                                          static_cast<std::uint64_t>(*seed_parameter));
+		std::cout << "generated " << file_count << " models in " << corpus_directory_path.generic_string() << std::endl;
+	}
+
+	if ((*simplifier_path_parameter).empty())
+	{
+		return 0;
+	}
+
+	HarnessOptions options;
+	options.simplifier_path = *simplifier_path_parameter;
+	options.work_directory_path = *work_directory_path_parameter;
+	options.repeat_count = *repeat_parameter;
+	options.verify_clean = *verify_clean_parameter;
+	for (const std::string& argument : *simplifier_arguments_parameter)
+	{
+		options.simplifier_arguments.push_back(argument);
+	}
+
+	std::vector<std::string> error_messages;
+	const std::vector<CategoryResult> results = run_benchmark(corpus_directory_path, options, error_messages);
+	for (const std::string& message : error_messages)
+	{
+		std::cerr << "error : " << message << std::endl;
+	}
+	for (const std::string& line : format_results(results))
+	{
+		std::cout << line << std::endl;
+	}
+
+	const std::filesystem::path results_file_path = *results_file_path_parameter;
+	if (!write_results(results_file_path, results))
+	{
+		std::cerr << "unable to write results : " << results_file_path.generic_string() << std::endl;
+
+		return 1;
+	}
+
+	if ((*baseline_file_path_parameter).empty())
+	{
+		return error_messages.empty() ? 0 : 1;
+	}
+
+	std::vector<CategoryResult> baseline;
+	if (!read_results(*baseline_file_path_parameter, baseline))
+	{
+		std::cerr << "unable to read baseline : " << *baseline_file_path_parameter << std::endl;
+
+		return 1;
+	}
+
+	bool regressed = false;
+	const std::vector<MetricComparison> comparisons = compare_results(results, baseline, *tolerance_parameter);
+	for (const MetricComparison& comparison : comparisons)
+	{
+		regressed = regressed || comparison.regressed;
+	}
+	for (const std::string& line : format_comparisons(comparisons))
+	{
+		std::cout << line << std::endl;
+	}
+
+	return (regressed || !error_messages.empty()) ? 1 : 0;
+}
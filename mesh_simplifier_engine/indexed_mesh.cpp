@@ -0,0 +1,247 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "indexed_mesh.h"
+
+#include "mesh_cache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	constexpr size_t chunk_size = 4096;
+
+	// vcg's Point3 ordering: by z, then y, then x
+	bool position_less(const std::array<float, 3>& p, const std::array<float, 3>& q)
+	{
+		return (p[2] != q[2]) ? p[2] < q[2] : (p[1] != q[1]) ? p[1] < q[1] : p[0] < q[0];
+	}
+
+	// DoubleArea of vcg::Clean, evaluated in the same float operations
+	float float_double_area(const std::array<float, 3>& p0, const std::array<float, 3>& p1,
+	                        const std::array<float, 3>& p2)
+	{
+		const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+		const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+		const float cross[3] = {
+			e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]
+		};
+
+		return std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	}
+}
+
+size_t IndexedMesh::live_face_count() const
+{
+	if (face_removed.empty())
+	{
+		return faces.size();
+	}
+
+	return faces.size() - std::count(face_removed.begin(), face_removed.end(), 1);
+}
+
+size_t IndexedMesh::live_vertex_count() const
+{
+	if (vertex_removed.empty())
+	{
+		return positions.size();
+	}
+
+	return positions.size() - std::count(vertex_removed.begin(), vertex_removed.end(), 1);
+}
+
+Vector3d face_normal(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2)
+{
+	return (p1 - p0).cross(p2 - p0);
+}
+
+double triangle_quality(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2)
+{
+	const double edge_sum = (p1 - p0).squared_length() + (p2 - p1).squared_length() + (p0 - p2).squared_length();
+	if (edge_sum == 0.0)
+	{
+		return 0.0;
+	}
+
+	// 4 * sqrt(3) * area / sum of the squared edges
+	return 2.0 * std::sqrt(3.0) * face_normal(p0, p1, p2).length() / edge_sum;
+}
+
+void clean_indexed_mesh(IndexedMesh& mesh, unsigned int thread_count)
+{
+	mesh.vertex_removed.resize(mesh.vertex_count(), 0);
+	mesh.face_removed.resize(mesh.face_count(), 0);
+
+	// RemoveFaceOutOfRangeArea(0): the area in float, like DoubleArea, so the same faces count as null
+	parallel_for_chunks(mesh.face_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			if (mesh.face_removed[f])
+			{
+				continue;
+			}
+
+			const auto& face = mesh.faces[f];
+			const float double_area = float_double_area(mesh.positions[face[0]], mesh.positions[face[1]],
+			                                            mesh.positions[face[2]]);
+			if (double_area <= 0.0f || double_area >= std::numeric_limits<float>::infinity())
+			{
+				mesh.face_removed[f] = 1;
+			}
+		}
+	});
+
+	// RemoveDuplicateVertex: every vertex, removed ones included, sorted by position and then index. along a
+	// run of equal positions a live vertex merges into the one before it while both are live; any removed
+	// vertex starts over. runs are independent, so each is walked by the chunk it starts in.
+	std::vector<std::uint32_t> order(mesh.vertex_count());
+	std::iota(order.begin(), order.end(), 0u);
+	parallel_sort(order, chunk_size, thread_count, [&](std::uint32_t a, std::uint32_t b)
+	{
+		const auto& p = mesh.positions[a];
+		const auto& q = mesh.positions[b];
+
+		return (p == q) ? a < b : position_less(p, q);
+	});
+
+	std::vector<std::uint32_t> representative(mesh.vertex_count());
+	std::iota(representative.begin(), representative.end(), 0u);
+	parallel_for_chunks(order.size(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t start = begin; start < end; ++start)
+		{
+			if (start > 0 && mesh.positions[order[start]] == mesh.positions[order[start - 1]])
+			{
+				continue;
+			}
+
+			size_t survivor = start;
+			for (size_t i = start + 1; i < order.size() && mesh.positions[order[i]] == mesh.positions[order[start]]; ++i)
+			{
+				if (!mesh.vertex_removed[order[i]] && !mesh.vertex_removed[order[survivor]])
+				{
+					representative[order[i]] = order[survivor];
+				}
+				else
+				{
+					survivor = i;
+				}
+			}
+		}
+	});
+	parallel_for_chunks(mesh.vertex_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			if (representative[v] != v)
+			{
+				mesh.vertex_removed[v] = 1;
+			}
+		}
+	});
+
+	// the relinking and RemoveDegenerateFace
+	parallel_for_chunks(mesh.face_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			if (mesh.face_removed[f])
+			{
+				continue;
+			}
+
+			auto& face = mesh.faces[f];
+			for (std::uint32_t& vertex : face)
+			{
+				vertex = representative[vertex];
+			}
+			if (face[0] == face[1] || face[0] == face[2] || face[1] == face[2])
+			{
+				mesh.face_removed[f] = 1;
+			}
+		}
+	});
+
+	// RemoveUnreferencedVertex
+	const VertexFaceAdjacency adjacency = build_vertex_face_adjacency(mesh);
+	parallel_for_chunks(mesh.vertex_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			if (adjacency.offsets[v] == adjacency.offsets[v + 1])
+			{
+				mesh.vertex_removed[v] = 1;
+			}
+		}
+	});
+}
+
+std::uint64_t geometry_hash(const IndexedMesh& mesh)
+{
+	std::uint64_t hash = fnv1a_64(mesh.positions.data(), mesh.positions.size() * sizeof(mesh.positions[0]));
+
+	return fnv1a_64(mesh.faces.data(), mesh.faces.size() * sizeof(mesh.faces[0]), hash);
+}
+
+VertexFaceAdjacency build_vertex_face_adjacency(const IndexedMesh& mesh)
+{
+	VertexFaceAdjacency result;
+	result.offsets.assign(mesh.vertex_count() + 1, 0);
+
+	for (size_t f = 0; f < mesh.face_count(); ++f)
+	{
+		if (mesh.is_face_removed(f))
+		{
+			continue;
+		}
+		for (const std::uint32_t vertex : mesh.faces[f])
+		{
+			++result.offsets[vertex + 1];
+		}
+	}
+	for (size_t v = 0; v < mesh.vertex_count(); ++v)
+	{
+		result.offsets[v + 1] += result.offsets[v];
+	}
+
+	result.face_ids.resize(result.offsets.back());
+	std::vector<std::uint32_t> cursor(result.offsets.begin(), result.offsets.end() - 1);
+	for (size_t f = 0; f < mesh.face_count(); ++f)
+	{
+		if (mesh.is_face_removed(f))
+		{
+			continue;
+		}
+		for (const std::uint32_t vertex : mesh.faces[f])
+		{
+			result.face_ids[cursor[vertex]++] = static_cast<std::uint32_t>(f);
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,121 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct Vector3d
+{
+	double x = 0.0;
+	double y = 0.0;
+	double z = 0.0;
+
+	Vector3d() = default;
+
+	Vector3d(double x, double y, double z)
+		: x(x), y(y), z(z)
+	{
+	}
+
+	explicit Vector3d(const std::array<float, 3>& p)
+		: x(p[0]), y(p[1]), z(p[2])
+	{
+	}
+
+	Vector3d operator+(const Vector3d& other) const { return {x + other.x, y + other.y, z + other.z}; }
+	Vector3d operator-(const Vector3d& other) const { return {x - other.x, y - other.y, z - other.z}; }
+	Vector3d operator*(double scale) const { return {x * scale, y * scale, z * scale}; }
+
+	double dot(const Vector3d& other) const { return x * other.x + y * other.y + z * other.z; }
+
+	Vector3d cross(const Vector3d& other) const
+	{
+		return {y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x};
+	}
+
+	double squared_length() const { return dot(*this); }
+	double length() const { return std::sqrt(squared_length()); }
+
+	std::array<float, 3> to_float() const
+	{
+		return {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)};
+	}
+};
+
+// triangle mesh as plain arrays, independent of meshlab, for the in-tree decimation engines. faces keep their
+// slots while decimating: a collapse rewrites vertex ids and flags removed elements instead of erasing them,
+// so per-face attributes kept elsewhere stay addressable by face index.
+struct IndexedMesh
+{
+	std::vector<std::array<float, 3>> positions;
+	std::vector<std::array<std::uint32_t, 3>> faces;
+
+	// empty until something is removed
+	std::vector<std::uint8_t> vertex_removed;
+	std::vector<std::uint8_t> face_removed;
+
+	size_t vertex_count() const { return positions.size(); }
+	size_t face_count() const { return faces.size(); }
+
+	bool is_vertex_removed(size_t vertex) const
+	{
+		return !vertex_removed.empty() && vertex_removed[vertex] != 0;
+	}
+
+	bool is_face_removed(size_t face) const
+	{
+		return !face_removed.empty() && face_removed[face] != 0;
+	}
+
+	size_t live_face_count() const;
+	size_t live_vertex_count() const;
+};
+
+// unnormalized, its length is twice the area
+Vector3d face_normal(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2);
+
+// 1 for an equilateral triangle, 0 for a degenerate one.
+double triangle_quality(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2);
+
+// the filter's AutoClean without its compaction, pass for pass as vcg::tri::Clean runs it: RemoveFaceOutOfRangeArea
+// with a zero threshold, RemoveDuplicateVertex (merging into the same survivors and relinking the faces, then
+// RemoveDegenerateFace) and RemoveUnreferencedVertex. the elements flagged as removed are those the serial
+// passes delete. the passes are parallel scans, the vertex sort a parallel merge sort, so the result does not
+// depend on thread_count.
+void clean_indexed_mesh(IndexedMesh& mesh, unsigned int thread_count = 1);
+
+// fnv-1a over the positions and faces, identifying a geometry for persisted per-mesh data.
+std::uint64_t geometry_hash(const IndexedMesh& mesh);
+
+// vertex -> faces adjacency in compressed rows: the faces of v are face_ids[offsets[v], offsets[v + 1]).
+struct VertexFaceAdjacency
+{
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> face_ids;
+};
+
+VertexFaceAdjacency build_vertex_face_adjacency(const IndexedMesh& mesh);
@@ -0,0 +1,187 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_buffers.h"
+
+#include <common/ml_document/mesh_model.h>
+
+#include <algorithm>
+
+namespace
+{
+	void write_mesh_model(const MeshModel& mesh_model, float* positions, std::uint32_t* indices, float* uvs,
+	                      float* normals)
+	{
+		const CMeshO& mesh = mesh_model.cm;
+
+		std::vector<std::uint32_t> remap(mesh.vert.size());
+		std::uint32_t vertex_index = 0;
+		for (size_t i = 0; i < mesh.vert.size(); ++i)
+		{
+			const CVertexO& vertex = mesh.vert[i];
+			if (vertex.IsD())
+			{
+				continue;
+			}
+
+			remap[i] = vertex_index;
+			for (int k = 0; k < 3; ++k)
+			{
+				positions[vertex_index * 3 + k] = vertex.cP()[k];
+			}
+			if (uvs != nullptr)
+			{
+				uvs[vertex_index * 2] = vertex.cT().U();
+				uvs[vertex_index * 2 + 1] = vertex.cT().V();
+			}
+			if (normals != nullptr)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					normals[vertex_index * 3 + k] = vertex.cN()[k];
+				}
+			}
+			++vertex_index;
+		}
+
+		size_t index = 0;
+		for (const CFaceO& face : mesh.face)
+		{
+			if (face.IsD())
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				indices[index++] = remap[face.cV(k) - &mesh.vert[0]];
+			}
+		}
+	}
+}
+
+bool valid_mesh_view(const MeshView& view)
+{
+	if (view.positions == nullptr || view.indices == nullptr || view.vertex_count == 0 || view.triangle_count == 0)
+	{
+		return false;
+	}
+
+	return std::all_of(view.indices, view.indices + view.triangle_count * 3, [&view](std::uint32_t index)
+	{
+		return index < view.vertex_count;
+	});
+}
+
+void fill_mesh_model(const MeshView& view, MeshModel& mesh_model)
+{
+	CMeshO& mesh = mesh_model.cm;
+
+	if (view.uvs != nullptr)
+	{
+		mesh_model.updateDataMask(MeshModel::MM_VERTTEXCOORD);
+	}
+
+	auto vertex_iterator = vcg::tri::Allocator<CMeshO>::AddVertices(mesh, view.vertex_count);
+	for (size_t i = 0; i < view.vertex_count; ++i, ++vertex_iterator)
+	{
+		const float* position = view.positions + i * 3;
+		vertex_iterator->P() = vcg::Point3f(position[0], position[1], position[2]);
+
+		if (view.uvs != nullptr)
+		{
+			vertex_iterator->T().U() = view.uvs[i * 2];
+			vertex_iterator->T().V() = view.uvs[i * 2 + 1];
+		}
+		if (view.normals != nullptr)
+		{
+			const float* normal = view.normals + i * 3;
+			vertex_iterator->N() = vcg::Point3f(normal[0], normal[1], normal[2]);
+		}
+	}
+
+	auto face_iterator = vcg::tri::Allocator<CMeshO>::AddFaces(mesh, view.triangle_count);
+	for (size_t i = 0; i < view.triangle_count; ++i, ++face_iterator)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			face_iterator->V(k) = &mesh.vert[view.indices[i * 3 + k]];
+		}
+	}
+
+	// the filter wants face normals and the bounding box; keep the caller's vertex normals
+	if (view.normals != nullptr)
+	{
+		vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mesh);
+		vcg::tri::UpdateBounding<CMeshO>::Box(mesh);
+	}
+	else
+	{
+		mesh_model.updateBoxAndNormals();
+	}
+}
+
+void read_mesh_model(const MeshModel& mesh_model, bool with_uvs, bool with_normals, MeshData& data)
+{
+	const size_t vertex_count = mesh_model.cm.vn;
+	const size_t triangle_count = mesh_model.cm.fn;
+
+	data.positions.resize(vertex_count * 3);
+	data.indices.resize(triangle_count * 3);
+	data.uvs.resize(with_uvs ? vertex_count * 2 : 0);
+	data.normals.resize(with_normals ? vertex_count * 3 : 0);
+
+	write_mesh_model(mesh_model, data.positions.data(), data.indices.data(), with_uvs ? data.uvs.data() : nullptr,
+	                 with_normals ? data.normals.data() : nullptr);
+}
+
+bool read_mesh_model(const MeshModel& mesh_model, bool with_uvs, bool with_normals, MeshBuffers& buffers)
+{
+	buffers.vertex_count = mesh_model.cm.vn;
+	buffers.triangle_count = mesh_model.cm.fn;
+	if (buffers.positions == nullptr || buffers.indices == nullptr ||
+		buffers.vertex_capacity < buffers.vertex_count || buffers.triangle_capacity < buffers.triangle_count)
+	{
+		return false;
+	}
+
+	write_mesh_model(mesh_model, buffers.positions, buffers.indices, with_uvs ? buffers.uvs : nullptr,
+	                 with_normals ? buffers.normals : nullptr);
+
+	return true;
+}
+
+std::uint64_t mesh_view_bytes(const MeshView& view)
+{
+	const size_t floats_per_vertex = 3 + (view.uvs != nullptr ? 2 : 0) + (view.normals != nullptr ? 3 : 0);
+
+	return view.vertex_count * floats_per_vertex * sizeof(float) + view.triangle_count * 3 * sizeof(std::uint32_t);
+}
+
+std::uint64_t mesh_model_bytes(const MeshModel& mesh_model, bool with_uvs, bool with_normals)
+{
+	const size_t floats_per_vertex = 3 + (with_uvs ? 2 : 0) + (with_normals ? 3 : 0);
+
+	return static_cast<std::uint64_t>(mesh_model.cm.vn) * floats_per_vertex * sizeof(float) +
+		static_cast<std::uint64_t>(mesh_model.cm.fn) * 3 * sizeof(std::uint32_t);
+}
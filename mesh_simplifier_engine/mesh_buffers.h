@@ -0,0 +1,92 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MeshModel;
+
+// non-owning view of an indexed triangle mesh.
+struct MeshView
+{
+	// x, y, z per vertex
+	const float* positions = nullptr;
+	size_t vertex_count = 0;
+	// three vertex indices per triangle
+	const std::uint32_t* indices = nullptr;
+	size_t triangle_count = 0;
+	// optional u, v per vertex
+	const float* uvs = nullptr;
+	// optional x, y, z per vertex
+	const float* normals = nullptr;
+};
+
+// output buffers owned by the caller. uvs and normals are written when they are not null and the input has them.
+struct MeshBuffers
+{
+	float* positions = nullptr;
+	size_t vertex_capacity = 0;
+	std::uint32_t* indices = nullptr;
+	size_t triangle_capacity = 0;
+	float* uvs = nullptr;
+	float* normals = nullptr;
+
+	// set by the simplification
+	size_t vertex_count = 0;
+	size_t triangle_count = 0;
+};
+
+// output buffers owned by the engine.
+struct MeshData
+{
+	std::vector<float> positions;
+	std::vector<std::uint32_t> indices;
+	std::vector<float> uvs;
+	std::vector<float> normals;
+
+	size_t vertex_count() const
+	{
+		return positions.size() / 3;
+	}
+
+	size_t triangle_count() const
+	{
+		return indices.size() / 3;
+	}
+};
+
+// false when positions or indices are missing or an index is out of range.
+bool valid_mesh_view(const MeshView& view);
+
+void fill_mesh_model(const MeshView& view, MeshModel& mesh_model);
+
+// copy the live vertices and faces, renumbering the vertices past the deleted ones.
+void read_mesh_model(const MeshModel& mesh_model, bool with_uvs, bool with_normals, MeshData& data);
+// false when the buffers are too small.
+bool read_mesh_model(const MeshModel& mesh_model, bool with_uvs, bool with_normals, MeshBuffers& buffers);
+
+std::uint64_t mesh_view_bytes(const MeshView& view);
+std::uint64_t mesh_model_bytes(const MeshModel& mesh_model, bool with_uvs, bool with_normals);
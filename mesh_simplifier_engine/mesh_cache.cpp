@@ -0,0 +1,452 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_cache.h"
+
+#include <common/ml_document/mesh_model.h>
+
+#include <QFile>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr char cache_magic[8] = {'M', 'S', 'M', 'E', 'S', 'H', '\0', '\0'};
+	constexpr std::uint32_t cache_version = 1;
+	constexpr std::uint64_t cache_alignment = 64;
+
+	enum CacheFlags : std::uint32_t
+	{
+		has_wedge_texcoords = 1 << 0,
+		has_face_colors = 1 << 1,
+	};
+
+	// array offsets are from the start of the file, 0 when the array is absent
+	struct CacheHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t flags;
+
+		std::uint64_t source_size;
+		std::int64_t source_modification_time;
+		std::uint64_t source_hash;
+
+		std::uint64_t vertex_count;
+		std::uint64_t face_count;
+
+		std::uint64_t positions_offset;
+		std::uint64_t normals_offset;
+		std::uint64_t indices_offset;
+		std::uint64_t wedge_texcoords_offset;
+		std::uint64_t wedge_texture_indices_offset;
+		std::uint64_t face_colors_offset;
+		// '\n' separated
+		std::uint64_t texture_names_offset;
+		std::uint64_t texture_names_size;
+	};
+
+	struct SourceStamp
+	{
+		std::uint64_t size = 0;
+		std::int64_t modification_time = 0;
+	};
+
+	bool read_source_stamp(const std::filesystem::path& input_path, SourceStamp& stamp)
+	{
+		std::error_code error;
+		stamp.size = std::filesystem::file_size(input_path, error);
+		if (error)
+		{
+			return false;
+		}
+		stamp.modification_time = std::filesystem::last_write_time(input_path, error).time_since_epoch().count();
+
+		return !error;
+	}
+
+	// best effort: a read-only cache directory only costs the hash again on the next run
+	void refresh_modification_time(const std::filesystem::path& file_path, std::int64_t modification_time)
+	{
+		std::fstream stream(file_path, std::ios::in | std::ios::out | std::ios::binary);
+		stream.seekp(offsetof(CacheHeader, source_modification_time));
+		stream.write(reinterpret_cast<const char*>(&modification_time), sizeof(modification_time));
+	}
+
+	std::uint64_t align(std::uint64_t offset)
+	{
+		return (offset + cache_alignment - 1) / cache_alignment * cache_alignment;
+	}
+
+	// lays the arrays out one after the other and records where each one starts
+	class CacheWriter
+	{
+	public:
+		std::uint64_t add(const void* p_data, std::uint64_t size)
+		{
+			if (size == 0)
+			{
+				return 0;
+			}
+
+			const std::uint64_t offset = align(sizeof(CacheHeader) + body_.size());
+			body_.resize(offset - sizeof(CacheHeader) + size);
+			std::memcpy(body_.data() + (offset - sizeof(CacheHeader)), p_data, size);
+
+			return offset;
+		}
+
+		bool write(const std::filesystem::path& file_path, const CacheHeader& header) const
+		{
+			std::ofstream stream(file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			stream.write(body_.data(), body_.size());
+
+			return static_cast<bool>(stream);
+		}
+
+	private:
+		std::vector<char> body_;
+	};
+}
+
+MeshCache::MeshCache(std::filesystem::path directory_path)
+	: directory_path_(std::move(directory_path))
+{
+}
+
+const std::filesystem::path& MeshCache::directory_path() const
+{
+	return directory_path_;
+}
+
+std::filesystem::path MeshCache::entry_path(const std::filesystem::path& input_path) const
+{
+	const std::string key = std::filesystem::absolute(input_path).generic_string();
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.mesh", static_cast<unsigned long long>(fnv1a_64(key.data(), key.size())));
+
+	return directory_path_ / name;
+}
+
+std::filesystem::path MeshCache::quadric_state_path(const std::filesystem::path& input_path) const
+{
+	std::filesystem::path result = entry_path(input_path);
+
+	return result += ".quadrics";
+}
+
+bool MeshCache::load(const std::filesystem::path& input_path, MeshModel& mesh_model) const
+{
+	SourceStamp stamp;
+	if (!read_source_stamp(input_path, stamp))
+	{
+		return false;
+	}
+
+	const std::filesystem::path file_path = entry_path(input_path);
+	QFile file(QString::fromUtf8(file_path.generic_string().c_str()));
+	if (!file.open(QIODevice::ReadOnly) || file.size() < static_cast<qint64>(sizeof(CacheHeader)))
+	{
+		return false;
+	}
+
+	const uchar* p_file = file.map(0, file.size());
+	if (p_file == nullptr)
+	{
+		return false;
+	}
+	const std::uint64_t file_size = file.size();
+
+	CacheHeader header;
+	std::memcpy(&header, p_file, sizeof(header));
+
+	const auto array_fits = [&](std::uint64_t offset, std::uint64_t size)
+	{
+		// an empty array is written with offset 0
+		return size == 0 || (offset != 0 && offset <= file_size && size <= file_size - offset);
+	};
+
+	const std::uint64_t vertex_count = header.vertex_count;
+	const std::uint64_t face_count = header.face_count;
+	bool valid = std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) == 0 &&
+		header.version == cache_version && header.source_size == stamp.size &&
+		array_fits(header.positions_offset, vertex_count * 3 * sizeof(float)) &&
+		array_fits(header.normals_offset, vertex_count * 3 * sizeof(float)) &&
+		array_fits(header.indices_offset, face_count * 3 * sizeof(std::uint32_t)) &&
+		(!(header.flags & has_wedge_texcoords) ||
+			(array_fits(header.wedge_texcoords_offset, face_count * 6 * sizeof(float)) &&
+				array_fits(header.wedge_texture_indices_offset, face_count * 3 * sizeof(std::int16_t)))) &&
+		(!(header.flags & has_face_colors) || array_fits(header.face_colors_offset, face_count * 4)) &&
+		array_fits(header.texture_names_offset, header.texture_names_size);
+
+	// a copied or touched input is compared by content before the entry is given up, and on a match the new
+	// modification time is recorded so the next run does not hash it again
+	if (valid && header.source_modification_time != stamp.modification_time)
+	{
+		valid = header.source_hash == file_content_hash(input_path);
+		if (valid)
+		{
+			refresh_modification_time(file_path, stamp.modification_time);
+		}
+	}
+	if (!valid)
+	{
+		file.unmap(const_cast<uchar*>(p_file));
+
+		return false;
+	}
+
+	const auto* p_positions = reinterpret_cast<const float*>(p_file + header.positions_offset);
+	const auto* p_normals = reinterpret_cast<const float*>(p_file + header.normals_offset);
+	const auto* p_indices = reinterpret_cast<const std::uint32_t*>(p_file + header.indices_offset);
+
+	CMeshO& mesh = mesh_model.cm;
+
+	auto vertex_iterator = vcg::tri::Allocator<CMeshO>::AddVertices(mesh, vertex_count);
+	for (std::uint64_t i = 0; i < vertex_count; ++i, ++vertex_iterator)
+	{
+		vertex_iterator->P() = vcg::Point3f(p_positions[i * 3], p_positions[i * 3 + 1], p_positions[i * 3 + 2]);
+		vertex_iterator->N() = vcg::Point3f(p_normals[i * 3], p_normals[i * 3 + 1], p_normals[i * 3 + 2]);
+	}
+
+	if (header.flags & has_wedge_texcoords)
+	{
+		mesh_model.updateDataMask(MeshModel::MM_WEDGTEXCOORD);
+	}
+	if (header.flags & has_face_colors)
+	{
+		mesh_model.updateDataMask(MeshModel::MM_FACECOLOR);
+	}
+
+	bool indices_valid = true;
+	auto face_iterator = vcg::tri::Allocator<CMeshO>::AddFaces(mesh, face_count);
+	for (std::uint64_t i = 0; i < face_count; ++i, ++face_iterator)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const std::uint32_t index = p_indices[i * 3 + k];
+			indices_valid = indices_valid && index < vertex_count;
+			face_iterator->V(k) = &mesh.vert[index < vertex_count ? index : 0];
+		}
+
+		if (header.flags & has_wedge_texcoords)
+		{
+			const auto* p_texcoords = reinterpret_cast<const float*>(p_file + header.wedge_texcoords_offset) + i * 6;
+			const auto* p_texture_indices = reinterpret_cast<const std::int16_t*>(
+				p_file + header.wedge_texture_indices_offset) + i * 3;
+			for (int k = 0; k < 3; ++k)
+			{
+				face_iterator->WT(k).U() = p_texcoords[k * 2];
+				face_iterator->WT(k).V() = p_texcoords[k * 2 + 1];
+				face_iterator->WT(k).N() = p_texture_indices[k];
+			}
+		}
+		if (header.flags & has_face_colors)
+		{
+			const uchar* p_color = p_file + header.face_colors_offset + i * 4;
+			face_iterator->C() = vcg::Color4b(p_color[0], p_color[1], p_color[2], p_color[3]);
+		}
+	}
+
+	if (header.texture_names_size != 0)
+	{
+		const std::string names(reinterpret_cast<const char*>(p_file + header.texture_names_offset),
+		                        header.texture_names_size);
+		size_t start = 0;
+		for (size_t end = names.find('\n'); end != std::string::npos; start = end + 1, end = names.find('\n', start))
+		{
+			mesh.textures.push_back(names.substr(start, end - start));
+		}
+	}
+
+	file.unmap(const_cast<uchar*>(p_file));
+
+	if (!indices_valid)
+	{
+		return false;
+	}
+
+	vcg::tri::UpdateBounding<CMeshO>::Box(mesh);
+	vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mesh);
+	mesh_model.loadTextures(nullptr, nullptr);
+
+	return true;
+}
+
+bool MeshCache::store(const std::filesystem::path& input_path, const MeshModel& mesh_model) const
+{
+	SourceStamp stamp;
+	if (!read_source_stamp(input_path, stamp))
+	{
+		return false;
+	}
+
+	const CMeshO& mesh = mesh_model.cm;
+
+	std::vector<std::uint32_t> remap(mesh.vert.size());
+	std::vector<float> positions;
+	std::vector<float> normals;
+	positions.reserve(mesh.vn * 3);
+	normals.reserve(mesh.vn * 3);
+	for (size_t i = 0; i < mesh.vert.size(); ++i)
+	{
+		const CVertexO& vertex = mesh.vert[i];
+		if (vertex.IsD())
+		{
+			continue;
+		}
+
+		remap[i] = static_cast<std::uint32_t>(positions.size() / 3);
+		for (int k = 0; k < 3; ++k)
+		{
+			positions.push_back(vertex.cP()[k]);
+			normals.push_back(vertex.cN()[k]);
+		}
+	}
+
+	const bool with_texcoords = mesh_model.hasDataMask(MeshModel::MM_WEDGTEXCOORD);
+	const bool with_colors = mesh_model.hasDataMask(MeshModel::MM_FACECOLOR);
+
+	std::vector<std::uint32_t> indices;
+	std::vector<float> texcoords;
+	std::vector<std::int16_t> texture_indices;
+	std::vector<uchar> colors;
+	indices.reserve(mesh.fn * 3);
+	for (const CFaceO& face : mesh.face)
+	{
+		if (face.IsD())
+		{
+			continue;
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			indices.push_back(remap[face.cV(k) - &mesh.vert[0]]);
+			if (with_texcoords)
+			{
+				texcoords.push_back(face.cWT(k).U());
+				texcoords.push_back(face.cWT(k).V());
+				texture_indices.push_back(face.cWT(k).N());
+			}
+		}
+		if (with_colors)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				colors.push_back(face.cC()[k]);
+			}
+		}
+	}
+
+	std::string texture_names;
+	for (const std::string& texture_name : mesh.textures)
+	{
+		texture_names += texture_name + '\n';
+	}
+
+	CacheHeader header = {};
+	std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+	header.version = cache_version;
+	header.flags = (with_texcoords ? has_wedge_texcoords : 0) | (with_colors ? has_face_colors : 0);
+	header.source_size = stamp.size;
+	header.source_modification_time = stamp.modification_time;
+	header.source_hash = file_content_hash(input_path);
+	header.vertex_count = positions.size() / 3;
+	header.face_count = indices.size() / 3;
+
+	CacheWriter writer;
+	header.positions_offset = writer.add(positions.data(), positions.size() * sizeof(float));
+	header.normals_offset = writer.add(normals.data(), normals.size() * sizeof(float));
+	header.indices_offset = writer.add(indices.data(), indices.size() * sizeof(std::uint32_t));
+	header.wedge_texcoords_offset = writer.add(texcoords.data(), texcoords.size() * sizeof(float));
+	header.wedge_texture_indices_offset = writer.add(texture_indices.data(),
+	                                                 texture_indices.size() * sizeof(std::int16_t));
+	header.face_colors_offset = writer.add(colors.data(), colors.size());
+	header.texture_names_offset = writer.add(texture_names.data(), texture_names.size());
+	header.texture_names_size = texture_names.size();
+
+	std::error_code error;
+	create_directories(directory_path_, error);
+
+	// written aside and renamed, so a concurrent or interrupted run never maps a half written entry
+	const std::filesystem::path file_path = entry_path(input_path);
+	std::filesystem::path temporary_file_path = file_path;
+	temporary_file_path += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	if (!writer.write(temporary_file_path, header))
+	{
+		std::filesystem::remove(temporary_file_path, error);
+
+		return false;
+	}
+	std::filesystem::rename(temporary_file_path, file_path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary_file_path, error);
+
+		return false;
+	}
+
+	return true;
+}
+
+std::uint64_t fnv1a_64(const void* p_data, size_t size, std::uint64_t hash)
+{
+	const auto* p_bytes = static_cast<const unsigned char*>(p_data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= p_bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+std::uint64_t file_content_hash(const std::filesystem::path& file_path)
+{
+	QFile file(QString::fromUtf8(file_path.generic_string().c_str()));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return 0;
+	}
+	if (file.size() == 0)
+	{
+		return fnv1a_64(nullptr, 0);
+	}
+
+	const uchar* p_data = file.map(0, file.size());
+	if (p_data == nullptr)
+	{
+		return 0;
+	}
+	const std::uint64_t hash = fnv1a_64(p_data, file.size());
+	file.unmap(const_cast<uchar*>(p_data));
+
+	return hash;
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+class MeshModel;
+
+// keeps imported meshes as binary files (a header followed by 64 byte aligned arrays) so a repeat import
+// memory-maps the entry instead of running the io plugin. entries are named after a hash of the input path
+// and hold the input size, modification time and content hash: a touched but unchanged input still hits.
+// only what the exporter writes is kept: positions, vertex normals, wedge texture coordinates, face colors
+// and the texture names; the textures themselves are loaded again from beside the input.
+class MeshCache
+{
+public:
+	explicit MeshCache(std::filesystem::path directory_path);
+
+	const std::filesystem::path& directory_path() const;
+
+	std::filesystem::path entry_path(const std::filesystem::path& input_path) const;
+	// the decimator state persisted beside the entry, see quadric_cache.h
+	std::filesystem::path quadric_state_path(const std::filesystem::path& input_path) const;
+
+	// fills an empty mesh model, false on a missing, stale or unreadable entry.
+	bool load(const std::filesystem::path& input_path, MeshModel& mesh_model) const;
+	bool store(const std::filesystem::path& input_path, const MeshModel& mesh_model) const;
+
+private:
+	std::filesystem::path directory_path_;
+};
+
+std::uint64_t fnv1a_64(const void* p_data, size_t size, std::uint64_t hash = 14695981039346656037ull);
+
+// fnv1a_64 of the whole file, 0 when it cannot be read.
+std::uint64_t file_content_hash(const std::filesystem::path& file_path);
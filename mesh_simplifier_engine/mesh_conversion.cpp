@@ -0,0 +1,219 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_conversion.h"
+
+#include "parallel.h"
+
+#include <common/ml_document/mesh_model.h>
+
+#include <limits>
+
+namespace
+{
+	constexpr size_t chunk_size = 4096;
+
+	// the index of every live element once the deleted ones are squeezed out, returns the live count
+	template <typename Elements>
+	size_t remap_live_elements(const Elements& elements, unsigned int thread_count, std::vector<std::uint32_t>& remap)
+	{
+		const size_t chunk_count = (elements.size() + chunk_size - 1) / chunk_size;
+		std::vector<size_t> chunk_offsets(chunk_count + 1, 0);
+
+		parallel_for(chunk_count, thread_count, [&](size_t chunk)
+		{
+			const size_t end = std::min(elements.size(), (chunk + 1) * chunk_size);
+			for (size_t i = chunk * chunk_size; i < end; ++i)
+			{
+				chunk_offsets[chunk + 1] += !elements[i].IsD();
+			}
+		});
+		for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+		{
+			chunk_offsets[chunk + 1] += chunk_offsets[chunk];
+		}
+
+		remap.resize(elements.size());
+		parallel_for(chunk_count, thread_count, [&](size_t chunk)
+		{
+			size_t index = chunk_offsets[chunk];
+			const size_t end = std::min(elements.size(), (chunk + 1) * chunk_size);
+			for (size_t i = chunk * chunk_size; i < end; ++i)
+			{
+				remap[i] = elements[i].IsD() ? std::numeric_limits<std::uint32_t>::max()
+				                             : static_cast<std::uint32_t>(index++);
+			}
+		});
+
+		return chunk_offsets.back();
+	}
+}
+
+IndexedMesh to_indexed_mesh(const MeshModel& mesh_model, unsigned int thread_count)
+{
+	const CMeshO& mesh = mesh_model.cm;
+
+	IndexedMesh result;
+	result.positions.resize(mesh.vert.size());
+	result.faces.resize(mesh.face.size());
+	result.vertex_removed.resize(mesh.vert.size(), 0);
+	result.face_removed.resize(mesh.face.size(), 0);
+
+	parallel_for_chunks(mesh.vert.size(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const vcg::Point3f& position = mesh.vert[i].cP();
+			result.positions[i] = {position[0], position[1], position[2]};
+			result.vertex_removed[i] = mesh.vert[i].IsD();
+		}
+	});
+
+	parallel_for_chunks(mesh.face.size(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const CFaceO& face = mesh.face[i];
+			if (face.IsD())
+			{
+				result.face_removed[i] = 1;
+				result.faces[i] = {0, 0, 0};
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				result.faces[i][k] = static_cast<std::uint32_t>(face.cV(k) - &mesh.vert[0]);
+			}
+		}
+	});
+
+	return result;
+}
+
+void apply_indexed_mesh(const IndexedMesh& mesh, MeshModel& mesh_model, unsigned int thread_count)
+{
+	CMeshO& mesh_o = mesh_model.cm;
+
+	parallel_for_chunks(mesh.vertex_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			CVertexO& vertex = mesh_o.vert[i];
+			if (mesh.is_vertex_removed(i))
+			{
+				if (!vertex.IsD())
+				{
+					vertex.SetD();
+				}
+				continue;
+			}
+
+			const auto& position = mesh.positions[i];
+			vertex.P() = vcg::Point3f(position[0], position[1], position[2]);
+		}
+	});
+
+	parallel_for_chunks(mesh.face_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			CFaceO& face = mesh_o.face[i];
+			if (mesh.is_face_removed(i))
+			{
+				if (!face.IsD())
+				{
+					face.SetD();
+				}
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				face.V(k) = &mesh_o.vert[mesh.faces[i][k]];
+			}
+		}
+	});
+
+	// what Allocator::DeleteVertex and DeleteFace would have counted down
+	mesh_o.vn = static_cast<int>(mesh.live_vertex_count());
+	mesh_o.fn = static_cast<int>(mesh.live_face_count());
+}
+
+void compact_mesh(MeshModel& mesh_model, unsigned int thread_count)
+{
+	CMeshO& mesh = mesh_model.cm;
+
+	std::vector<std::uint32_t> vertex_remap;
+	std::vector<std::uint32_t> face_remap;
+	const size_t vertex_count = remap_live_elements(mesh.vert, thread_count, vertex_remap);
+	const size_t face_count = remap_live_elements(mesh.face, thread_count, face_remap);
+
+	// the faces are relinked before any vertex moves, they only hold pointers into the vertex vector
+	parallel_for_chunks(mesh.face.size(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			CFaceO& face = mesh.face[i];
+			if (face.IsD())
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				face.V(k) = &mesh.vert[vertex_remap[face.cV(k) - &mesh.vert[0]]];
+			}
+		}
+	});
+
+	// every live element moves down to its remapped index, never past one that has yet to move
+	for (size_t i = 0; i < mesh.vert.size(); ++i)
+	{
+		if (!mesh.vert[i].IsD() && vertex_remap[i] != i)
+		{
+			mesh.vert[vertex_remap[i]].ImportData(mesh.vert[i]);
+		}
+	}
+	for (size_t i = 0; i < mesh.face.size(); ++i)
+	{
+		if (mesh.face[i].IsD() || face_remap[i] == i)
+		{
+			continue;
+		}
+
+		CFaceO& face = mesh.face[face_remap[i]];
+		face.ImportData(mesh.face[i]);
+		for (int k = 0; k < 3; ++k)
+		{
+			face.V(k) = mesh.face[i].cV(k);
+		}
+	}
+
+	// shrinking does not reallocate, so the relinked pointers stay valid; the adjacency does not
+	mesh.vert.resize(vertex_count);
+	mesh.face.resize(face_count);
+	mesh.vn = static_cast<int>(vertex_count);
+	mesh.fn = static_cast<int>(face_count);
+	mesh_model.clearDataMask(MeshModel::MM_VERTFACETOPO | MeshModel::MM_FACEFACETOPO);
+}
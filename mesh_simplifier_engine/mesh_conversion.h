@@ -0,0 +1,41 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+
+class MeshModel;
+
+// vertex and face i of the result are vertex and face i of the model; deleted elements are flagged as removed.
+IndexedMesh to_indexed_mesh(const MeshModel& mesh_model, unsigned int thread_count = 1);
+
+// writes an IndexedMesh back into the model it was taken from: moves the vertices, relinks the faces and
+// flags the removed elements as deleted. per-face data (wedge texture coordinates, colors) follows its face.
+void apply_indexed_mesh(const IndexedMesh& mesh, MeshModel& mesh_model, unsigned int thread_count = 1);
+
+// squeezes the deleted elements out of the model in place, keeping the live ones in their order: what
+// Allocator::CompactEveryVector leaves. the new indices come from prefix sums of per-chunk live counts and the
+// faces are relinked in parallel, so the result does not depend on thread_count; the elements themselves move
+// in one ordered pass, as in vcg. the adjacency is dropped.
+void compact_mesh(MeshModel& mesh_model, unsigned int thread_count = 1);
@@ -0,0 +1,85 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_deviation.h"
+
+#include <common/ml_document/mesh_model.h>
+
+#include <vcg/complex/algorithms/closest.h>
+#include <vcg/space/index/grid_static_ptr.h>
+
+#include <algorithm>
+
+SurfaceDeviation measure_deviation(const MeshModel& original, MeshModel& simplified, size_t max_samples)
+{
+	SurfaceDeviation result;
+	result.diagonal = original.cm.bbox.Diag();
+
+	CMeshO& mesh = simplified.cm;
+	if (mesh.fn == 0 || original.cm.vn == 0)
+	{
+		return result;
+	}
+
+	simplified.updateDataMask(MeshModel::MM_FACEMARK);
+	vcg::tri::UpdateBounding<CMeshO>::Box(mesh);
+	vcg::tri::UpdateNormal<CMeshO>::PerFaceNormalized(mesh);
+
+	vcg::GridStaticPtr<CFaceO, CMeshO::ScalarType> grid;
+	grid.Set(mesh.face.begin(), mesh.face.end());
+
+	vcg::tri::FaceTmark<CMeshO> marker;
+	marker.SetMesh(&mesh);
+	vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> point_face_distance;
+
+	const CMeshO::ScalarType search_distance = static_cast<CMeshO::ScalarType>(result.diagonal);
+	const size_t stride = std::max<size_t>(1, original.cm.vert.size() / std::max<size_t>(1, max_samples));
+
+	double distance_sum = 0.0;
+	for (size_t i = 0; i < original.cm.vert.size(); i += stride)
+	{
+		const CVertexO& vertex = original.cm.vert[i];
+		if (vertex.IsD())
+		{
+			continue;
+		}
+
+		CMeshO::ScalarType distance = search_distance;
+		vcg::Point3<CMeshO::ScalarType> closest;
+		if (vcg::GridClosest(grid, point_face_distance, marker, vertex.cP(), search_distance, distance, closest) ==
+			nullptr)
+		{
+			distance = search_distance;
+		}
+
+		result.max_distance = std::max<double>(result.max_distance, distance);
+		distance_sum += distance;
+		++result.sample_count;
+	}
+	if (result.sample_count != 0)
+	{
+		result.mean_distance = distance_sum / result.sample_count;
+	}
+
+	return result;
+}
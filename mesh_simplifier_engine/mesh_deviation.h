@@ -0,0 +1,42 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <cstddef>
+
+class MeshModel;
+
+struct SurfaceDeviation
+{
+	// distances from the original vertices to the simplified surface, in model units
+	double max_distance = 0.0;
+	double mean_distance = 0.0;
+	// bounding box diagonal of the original, to compare models of different sizes
+	double diagonal = 0.0;
+	size_t sample_count = 0;
+};
+
+// one-sided hausdorff estimate, sampling at most max_samples of the original vertices. the simplified model
+// gets face normals, face marks and its bounding box updated.
+SurfaceDeviation measure_deviation(const MeshModel& original, MeshModel& simplified, size_t max_samples);
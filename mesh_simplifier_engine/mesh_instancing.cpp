@@ -0,0 +1,628 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_instancing.h"
+
+#include "mesh_cache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace
+{
+	// larger components are decimated but not kept in the library, which would soon drop them again
+	constexpr size_t max_library_face_count = 65536;
+	// largest vertex distance the fitted transform of a copy may leave, relative to the component's rms radius
+	constexpr double instance_tolerance = 1e-4;
+	// the principal moment ratios in the key are rounded to this step
+	constexpr double moment_step = 1e-3;
+	// jacobi sweeps of the 3x3 eigen decomposition, far more than it takes to converge
+	constexpr int max_jacobi_sweeps = 50;
+
+	constexpr std::uint32_t no_index = std::numeric_limits<std::uint32_t>::max();
+
+	struct Component
+	{
+		// ascending
+		std::vector<std::uint32_t> faces;
+		// in the order the faces first use them
+		std::vector<std::uint32_t> vertices;
+	};
+
+	// eigenvalues, descending, and eigenvectors (the columns of vectors) of a symmetric 3x3 matrix, by cyclic
+	// jacobi rotations
+	void symmetric_eigen(double a[3][3], double values[3], double vectors[3][3])
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				vectors[i][j] = (i == j) ? 1.0 : 0.0;
+			}
+		}
+
+		for (int sweep = 0; sweep < max_jacobi_sweeps; ++sweep)
+		{
+			const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			const double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+			if (off <= DBL_EPSILON * DBL_EPSILON * diagonal)
+			{
+				break;
+			}
+
+			for (int p = 0; p < 2; ++p)
+			{
+				for (int q = p + 1; q < 3; ++q)
+				{
+					if (a[p][q] == 0.0)
+					{
+						continue;
+					}
+
+					const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					const double t = ((theta < 0.0) ? -1.0 : 1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+					const double c = 1.0 / std::sqrt(t * t + 1.0);
+					const double s = t * c;
+					for (int k = 0; k < 3; ++k)
+					{
+						const double kp = a[k][p];
+						const double kq = a[k][q];
+						a[k][p] = c * kp - s * kq;
+						a[k][q] = s * kp + c * kq;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						const double pk = a[p][k];
+						const double qk = a[q][k];
+						a[p][k] = c * pk - s * qk;
+						a[q][k] = s * pk + c * qk;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						const double kp = vectors[k][p];
+						const double kq = vectors[k][q];
+						vectors[k][p] = c * kp - s * kq;
+						vectors[k][q] = s * kp + c * kq;
+					}
+				}
+			}
+		}
+
+		int order[3] = {0, 1, 2};
+		std::sort(order, order + 3, [&](int i, int j) { return a[i][i] > a[j][j]; });
+
+		double sorted_vectors[3][3];
+		for (int i = 0; i < 3; ++i)
+		{
+			values[i] = a[order[i]][order[i]];
+			for (int k = 0; k < 3; ++k)
+			{
+				sorted_vectors[k][i] = vectors[k][order[i]];
+			}
+		}
+		std::copy(&sorted_vectors[0][0], &sorted_vectors[0][0] + 9, &vectors[0][0]);
+	}
+
+	Vector3d multiply(const double m[3][3], const Vector3d& v)
+	{
+		return {
+			m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+			m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+			m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z
+		};
+	}
+
+	Vector3d centroid(const std::vector<std::array<float, 3>>& positions)
+	{
+		Vector3d result;
+		for (const auto& p : positions)
+		{
+			result = result + Vector3d(p);
+		}
+
+		return result * (1.0 / positions.size());
+	}
+
+	// the least squares rotation, scale and translation taking from onto the corresponding points of to (the
+	// polar factor of their cross covariance), checked to leave every point within tolerance. mirror images
+	// and components without extent in two directions do not match.
+	bool fit_similarity(const std::vector<std::array<float, 3>>& from, const std::vector<std::array<float, 3>>& to,
+	                    Similarity& transform)
+	{
+		if (from.size() != to.size() || from.empty())
+		{
+			return false;
+		}
+
+		transform.from = centroid(from);
+		transform.to = centroid(to);
+
+		double cross[3][3] = {};
+		double from_spread = 0.0;
+		double to_spread = 0.0;
+		double to_magnitude = 0.0;
+		for (size_t i = 0; i < from.size(); ++i)
+		{
+			const Vector3d a = Vector3d(from[i]) - transform.from;
+			const Vector3d b = Vector3d(to[i]) - transform.to;
+			const double a_coordinates[3] = {a.x, a.y, a.z};
+			const double b_coordinates[3] = {b.x, b.y, b.z};
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					cross[r][c] += b_coordinates[r] * a_coordinates[c];
+				}
+			}
+			from_spread += a.squared_length();
+			to_spread += b.squared_length();
+			to_magnitude = std::max<double>({to_magnitude, std::abs(to[i][0]), std::abs(to[i][1]), std::abs(to[i][2])});
+		}
+		if (!(from_spread > 0.0) || !(to_spread > 0.0))
+		{
+			return false;
+		}
+
+		// cross = U S V^T; the eigenvectors of cross^T cross are V, and U follows from cross V = U S
+		double normal[3][3] = {};
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					normal[r][c] += cross[k][r] * cross[k][c];
+				}
+			}
+		}
+		double values[3];
+		double v[3][3];
+		symmetric_eigen(normal, values, v);
+
+		const double largest = std::sqrt(std::max(values[0], 0.0));
+		Vector3d u_columns[3];
+		Vector3d v_columns[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const double singular = std::sqrt(std::max(values[i], 0.0));
+			v_columns[i] = {v[0][i], v[1][i], v[2][i]};
+			if (i < 2 && !(singular > largest * 1e-9))
+			{
+				return false;
+			}
+			if (i < 2 || singular > largest * 1e-9)
+			{
+				u_columns[i] = multiply(cross, v_columns[i]) * (1.0 / singular);
+			}
+			else
+			{
+				// a flat component: the third axes only have to complete both frames to rotations
+				v_columns[i] = v_columns[0].cross(v_columns[1]);
+				u_columns[i] = u_columns[0].cross(u_columns[1]);
+			}
+		}
+
+		for (int r = 0; r < 3; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				transform.rotation[r][c] = 0.0;
+				for (int k = 0; k < 3; ++k)
+				{
+					const double u[3] = {u_columns[k].x, u_columns[k].y, u_columns[k].z};
+					const double w[3] = {v_columns[k].x, v_columns[k].y, v_columns[k].z};
+					transform.rotation[r][c] += u[r] * w[c];
+				}
+			}
+		}
+		const Vector3d row0(transform.rotation[0][0], transform.rotation[0][1], transform.rotation[0][2]);
+		const Vector3d row1(transform.rotation[1][0], transform.rotation[1][1], transform.rotation[1][2]);
+		const Vector3d row2(transform.rotation[2][0], transform.rotation[2][1], transform.rotation[2][2]);
+		if (row0.cross(row1).dot(row2) < 0.0)
+		{
+			return false;
+		}
+		transform.scale = std::sqrt(to_spread / from_spread);
+
+		const double tolerance = instance_tolerance * std::sqrt(to_spread / to.size()) + 4.0 * FLT_EPSILON * to_magnitude;
+		const double squared_tolerance = tolerance * tolerance;
+		for (size_t i = 0; i < from.size(); ++i)
+		{
+			if ((transform.apply(Vector3d(from[i])) - Vector3d(to[i])).squared_length() > squared_tolerance)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::uint32_t find_root(std::vector<std::uint32_t>& parents, std::uint32_t vertex)
+	{
+		while (parents[vertex] != vertex)
+		{
+			parents[vertex] = parents[parents[vertex]];
+			vertex = parents[vertex];
+		}
+
+		return vertex;
+	}
+
+	// the components in the order of their first faces; local_index maps each vertex to its place in its component
+	std::vector<Component> find_components(const IndexedMesh& mesh, std::vector<std::uint32_t>& local_index)
+	{
+		std::vector<std::uint32_t> parents(mesh.vertex_count());
+		std::iota(parents.begin(), parents.end(), 0u);
+		for (size_t f = 0; f < mesh.face_count(); ++f)
+		{
+			if (mesh.is_face_removed(f))
+			{
+				continue;
+			}
+
+			const auto& face = mesh.faces[f];
+			for (int corner = 1; corner < 3; ++corner)
+			{
+				const std::uint32_t a = find_root(parents, face[0]);
+				const std::uint32_t b = find_root(parents, face[corner]);
+				parents[std::max(a, b)] = std::min(a, b);
+			}
+		}
+
+		std::vector<Component> result;
+		std::vector<std::uint32_t> root_component(mesh.vertex_count(), no_index);
+		local_index.assign(mesh.vertex_count(), no_index);
+		for (size_t f = 0; f < mesh.face_count(); ++f)
+		{
+			if (mesh.is_face_removed(f))
+			{
+				continue;
+			}
+
+			const auto& face = mesh.faces[f];
+			const std::uint32_t root = find_root(parents, face[0]);
+			if (root_component[root] == no_index)
+			{
+				root_component[root] = static_cast<std::uint32_t>(result.size());
+				result.emplace_back();
+			}
+
+			Component& component = result[root_component[root]];
+			component.faces.push_back(static_cast<std::uint32_t>(f));
+			for (const std::uint32_t vertex : face)
+			{
+				if (local_index[vertex] == no_index)
+				{
+					local_index[vertex] = static_cast<std::uint32_t>(component.vertices.size());
+					component.vertices.push_back(vertex);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<std::array<float, 3>> gather_positions(const IndexedMesh& mesh, const Component& component)
+	{
+		std::vector<std::array<float, 3>> result(component.vertices.size());
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			result[i] = mesh.positions[component.vertices[i]];
+		}
+
+		return result;
+	}
+
+	std::array<std::uint32_t, 3> local_face(const IndexedMesh& mesh, const std::vector<std::uint32_t>& local_index,
+	                                        std::uint32_t face)
+	{
+		const auto& global = mesh.faces[face];
+
+		return {local_index[global[0]], local_index[global[1]], local_index[global[2]]};
+	}
+
+	// the topology, the scale free principal moments and everything the decimation of the component depends on
+	std::uint64_t shape_key(const IndexedMesh& mesh, const Component& component,
+	                        const std::vector<std::uint32_t>& local_index, const DecimationSettings& settings)
+	{
+		const std::uint64_t counts[] = {component.vertices.size(), component.faces.size()};
+		std::uint64_t result = fnv1a_64(counts, sizeof(counts), decimation_settings_key(settings));
+		for (const std::uint32_t f : component.faces)
+		{
+			const std::array<std::uint32_t, 3> face = local_face(mesh, local_index, f);
+			result = fnv1a_64(face.data(), sizeof(face), result);
+		}
+
+		const std::vector<std::array<float, 3>> positions = gather_positions(mesh, component);
+		const Vector3d center = centroid(positions);
+		double covariance[3][3] = {};
+		for (const auto& p : positions)
+		{
+			const Vector3d d = Vector3d(p) - center;
+			const double coordinates[3] = {d.x, d.y, d.z};
+			for (int r = 0; r < 3; ++r)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					covariance[r][c] += coordinates[r] * coordinates[c];
+				}
+			}
+		}
+		double moments[3];
+		double axes[3][3];
+		symmetric_eigen(covariance, moments, axes);
+
+		const double total = moments[0] + moments[1] + moments[2];
+		const std::int64_t steps[] = {
+			(total > 0.0) ? std::llround(moments[0] / total / moment_step) : 0,
+			(total > 0.0) ? std::llround(moments[1] / total / moment_step) : 0,
+		};
+
+		return fnv1a_64(steps, sizeof(steps), result);
+	}
+
+	IndexedMesh extract_component(const IndexedMesh& mesh, const Component& component,
+	                              const std::vector<std::uint32_t>& local_index)
+	{
+		IndexedMesh result;
+		result.positions = gather_positions(mesh, component);
+		result.faces.reserve(component.faces.size());
+		for (const std::uint32_t f : component.faces)
+		{
+			result.faces.push_back(local_face(mesh, local_index, f));
+		}
+
+		return result;
+	}
+
+	// writes the decimated shape over the component, moved by transform unless that is null
+	void place_shape(IndexedMesh& mesh, const Component& component, const SimplifiedShape& shape,
+	                 const Similarity* p_transform)
+	{
+		const IndexedMesh& simplified = shape.simplified;
+		for (size_t i = 0; i < component.vertices.size(); ++i)
+		{
+			const std::uint32_t vertex = component.vertices[i];
+			if (simplified.is_vertex_removed(i))
+			{
+				mesh.vertex_removed[vertex] = 1;
+			}
+			else
+			{
+				mesh.positions[vertex] = p_transform
+					                         ? p_transform->apply(Vector3d(simplified.positions[i])).to_float()
+					                         : simplified.positions[i];
+			}
+		}
+
+		for (size_t i = 0; i < component.faces.size(); ++i)
+		{
+			const std::uint32_t face = component.faces[i];
+			if (simplified.is_face_removed(i))
+			{
+				mesh.face_removed[face] = 1;
+			}
+			else
+			{
+				const auto& local = simplified.faces[i];
+				mesh.faces[face] = {
+					component.vertices[local[0]], component.vertices[local[1]], component.vertices[local[2]]
+				};
+			}
+		}
+	}
+}
+
+Vector3d Similarity::apply(const Vector3d& p) const
+{
+	return multiply(rotation, (p - from) * scale) + to;
+}
+
+InstanceLibrary::InstanceLibrary(size_t max_face_count)
+	: max_face_count_(max_face_count)
+{
+}
+
+std::shared_ptr<const SimplifiedShape> InstanceLibrary::find(std::uint64_t key,
+                                                             const std::vector<std::array<float, 3>>& positions,
+                                                             Similarity& transform)
+{
+	std::vector<std::shared_ptr<const SimplifiedShape>> candidates;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		const auto range = index_.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			candidates.push_back(it->second->shape);
+		}
+	}
+
+	// fitted without the lock; the shape found is then marked used, unless it was dropped meanwhile
+	for (const auto& candidate : candidates)
+	{
+		if (fit_similarity(candidate->positions, positions, transform))
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			const auto range = index_.equal_range(key);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (it->second->shape == candidate)
+				{
+					entries_.splice(entries_.begin(), entries_, it->second);
+					break;
+				}
+			}
+
+			return candidate;
+		}
+	}
+
+	return nullptr;
+}
+
+void InstanceLibrary::insert(std::uint64_t key, std::shared_ptr<const SimplifiedShape> shape)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	face_count_ += shape->simplified.face_count();
+	entries_.push_front({key, std::move(shape)});
+	index_.emplace(key, entries_.begin());
+
+	while (face_count_ > max_face_count_ && entries_.size() > 1)
+	{
+		const auto last = std::prev(entries_.end());
+		face_count_ -= last->shape->simplified.face_count();
+		erase_index(last);
+		entries_.erase(last);
+	}
+}
+
+void InstanceLibrary::erase_index(std::list<Entry>::iterator entry)
+{
+	const auto range = index_.equal_range(entry->key);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == entry)
+		{
+			index_.erase(it);
+			return;
+		}
+	}
+}
+
+size_t decimate_instances(IndexedMesh& mesh, const DecimationSettings& settings, InstanceLibrary* p_library,
+                          const QuadricDecimator::ProgressFunction& progress)
+{
+	const size_t live_face_count = mesh.live_face_count();
+	if (live_face_count == 0)
+	{
+		return 0;
+	}
+	const double ratio = std::min(1.0, static_cast<double>(settings.target_face_count) / live_face_count);
+	mesh.vertex_removed.resize(mesh.vertex_count(), 0);
+	mesh.face_removed.resize(mesh.face_count(), 0);
+
+	std::vector<std::uint32_t> local_index;
+	const std::vector<Component> components = find_components(mesh, local_index);
+
+	std::vector<DecimationSettings> component_settings(components.size(), settings);
+	std::vector<std::uint64_t> keys(components.size());
+	parallel_for(components.size(), settings.thread_count, [&](size_t c)
+	{
+		component_settings[c].target_face_count = static_cast<size_t>(components[c].faces.size() * ratio);
+		keys[c] = shape_key(mesh, components[c], local_index, component_settings[c]);
+	});
+
+	// each component takes its shape from the library, from an earlier component (source), or decimates itself
+	std::vector<std::shared_ptr<const SimplifiedShape>> shapes(components.size());
+	std::vector<std::uint32_t> sources(components.size());
+	std::vector<Similarity> transforms(components.size());
+	std::unordered_multimap<std::uint64_t, std::uint32_t> originals;
+	size_t decimated_face_count = 0;
+	for (std::uint32_t c = 0; c < components.size(); ++c)
+	{
+		sources[c] = c;
+
+		const std::vector<std::array<float, 3>> positions = gather_positions(mesh, components[c]);
+		if (p_library)
+		{
+			shapes[c] = p_library->find(keys[c], positions, transforms[c]);
+			if (shapes[c])
+			{
+				continue;
+			}
+		}
+
+		const auto range = originals.equal_range(keys[c]);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (fit_similarity(gather_positions(mesh, components[it->second]), positions, transforms[c]))
+			{
+				sources[c] = it->second;
+				break;
+			}
+		}
+		if (sources[c] == c)
+		{
+			originals.emplace(keys[c], c);
+			decimated_face_count += components[c].faces.size();
+		}
+	}
+
+	// decimated one after the other, so the progress and the cancellation stay on this thread
+	std::vector<std::uint8_t> decimated(components.size(), 0);
+	size_t done_face_count = 0;
+	for (std::uint32_t c = 0; c < components.size(); ++c)
+	{
+		if (shapes[c] || sources[c] != c)
+		{
+			continue;
+		}
+		decimated[c] = 1;
+
+		auto shape = std::make_shared<SimplifiedShape>();
+		shape->simplified = extract_component(mesh, components[c], local_index);
+		shape->positions = shape->simplified.positions;
+
+		const size_t face_count = components[c].faces.size();
+		QuadricDecimator decimator(shape->simplified, component_settings[c]);
+		decimator.initialize();
+		decimator.decimate([&](int percent)
+		{
+			if (progress)
+			{
+				progress(static_cast<int>((done_face_count + face_count * percent / 100) * 100 / decimated_face_count));
+			}
+		});
+		done_face_count += face_count;
+
+		if (p_library && face_count <= max_library_face_count)
+		{
+			p_library->insert(keys[c], shape);
+		}
+		shapes[c] = std::move(shape);
+	}
+
+	// components are disjoint, so each writes only its own elements
+	parallel_for(components.size(), settings.thread_count, [&](size_t c)
+	{
+		if (decimated[c])
+		{
+			place_shape(mesh, components[c], *shapes[c], nullptr);
+		}
+		else
+		{
+			place_shape(mesh, components[c], shapes[c] ? *shapes[c] : *shapes[sources[c]], &transforms[c]);
+		}
+	});
+
+	return components.size() - std::count(decimated.begin(), decimated.end(), 1);
+}
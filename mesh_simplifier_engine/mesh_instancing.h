@@ -0,0 +1,92 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+#include "quadric_decimator.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// a rotation, uniform scale and translation: p -> rotation * (p - from) * scale + to
+struct Similarity
+{
+	double rotation[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+	double scale = 1.0;
+	Vector3d from;
+	Vector3d to;
+
+	Vector3d apply(const Vector3d& p) const;
+};
+
+// a connected component as decimated once, for every copy of it
+struct SimplifiedShape
+{
+	// the component as found, its vertices in the order its faces first use them
+	std::vector<std::array<float, 3>> positions;
+	// the component after decimation, in the same vertex and face order
+	IndexedMesh simplified;
+};
+
+// decimated shapes by key, shared by every mesh decimated with it so that copies of a part in other files are
+// found as well. the least recently used shapes are dropped once the shapes hold more than max_face_count faces
+// in total. may be used from several threads at once.
+class InstanceLibrary
+{
+public:
+	explicit InstanceLibrary(size_t max_face_count = 4 * 1024 * 1024);
+
+	// a shape under key whose positions map onto these within tolerance, and the transform that maps them
+	std::shared_ptr<const SimplifiedShape> find(std::uint64_t key, const std::vector<std::array<float, 3>>& positions,
+	                                            Similarity& transform);
+	void insert(std::uint64_t key, std::shared_ptr<const SimplifiedShape> shape);
+
+private:
+	struct Entry
+	{
+		std::uint64_t key;
+		std::shared_ptr<const SimplifiedShape> shape;
+	};
+
+	void erase_index(std::list<Entry>::iterator entry);
+
+	std::mutex mutex_;
+	size_t max_face_count_;
+	size_t face_count_ = 0;
+	// most recently used first
+	std::list<Entry> entries_;
+	std::unordered_multimap<std::uint64_t, std::list<Entry>::iterator> index_;
+};
+
+// decimates every connected component on its own to the settings' overall face ratio, and every component
+// that is a copy of another (the same faces, the vertices rotated, uniformly scaled and translated) only once:
+// the copies get the decimated shape moved into place. candidates share a key of their topology and scale free
+// principal moments and are confirmed vertex by vertex. shapes are taken from and added to p_library, when
+// given. returns the number of components that reused a decimated shape.
+size_t decimate_instances(IndexedMesh& mesh, const DecimationSettings& settings, InstanceLibrary* p_library,
+                          const QuadricDecimator::ProgressFunction& progress = {});
@@ -0,0 +1,117 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "mesh_normals.h"
+
+#include "mesh_conversion.h"
+#include "parallel.h"
+
+#include <common/ml_document/mesh_model.h>
+
+#include <algorithm>
+
+namespace
+{
+	constexpr size_t chunk_size = 4096;
+
+	// the angle at p0 of the triangle p0 p1 p2
+	double corner_angle(const Vector3d& p0, const Vector3d& p1, const Vector3d& p2)
+	{
+		const Vector3d e1 = p1 - p0;
+		const Vector3d e2 = p2 - p0;
+		const double lengths = e1.length() * e2.length();
+		if (lengths == 0.0)
+		{
+			return 0.0;
+		}
+
+		return std::acos(std::clamp(e1.dot(e2) / lengths, -1.0, 1.0));
+	}
+}
+
+void update_normals(MeshModel& mesh_model, NormalWeighting weighting, unsigned int thread_count)
+{
+	CMeshO& mesh_o = mesh_model.cm;
+	const IndexedMesh mesh = to_indexed_mesh(mesh_model, thread_count);
+
+	std::vector<Vector3d> face_normals(mesh.face_count());
+	parallel_for_chunks(mesh.face_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			if (mesh.is_face_removed(f))
+			{
+				continue;
+			}
+
+			const auto& face = mesh.faces[f];
+			face_normals[f] = face_normal(Vector3d(mesh.positions[face[0]]), Vector3d(mesh.positions[face[1]]),
+			                              Vector3d(mesh.positions[face[2]]));
+
+			const double length = face_normals[f].length();
+			const Vector3d unit = (length > 0.0) ? face_normals[f] * (1.0 / length) : face_normals[f];
+			mesh_o.face[f].N() = vcg::Point3f(unit.x, unit.y, unit.z);
+		}
+	});
+
+	const VertexFaceAdjacency adjacency = build_vertex_face_adjacency(mesh);
+	parallel_for_chunks(mesh.vertex_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			if (mesh.is_vertex_removed(v))
+			{
+				continue;
+			}
+
+			Vector3d sum;
+			for (std::uint32_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i)
+			{
+				const std::uint32_t f = adjacency.face_ids[i];
+				if (weighting == NormalWeighting::area)
+				{
+					sum = sum + face_normals[f];
+					continue;
+				}
+
+				const auto& face = mesh.faces[f];
+				const int corner = face[0] == v ? 0 : (face[1] == v ? 1 : 2);
+				const double angle = corner_angle(Vector3d(mesh.positions[face[corner]]),
+				                                  Vector3d(mesh.positions[face[(corner + 1) % 3]]),
+				                                  Vector3d(mesh.positions[face[(corner + 2) % 3]]));
+				const double length = face_normals[f].length();
+				if (length > 0.0)
+				{
+					sum = sum + face_normals[f] * (angle / length);
+				}
+			}
+
+			const double length = sum.length();
+			if (length > 0.0)
+			{
+				sum = sum * (1.0 / length);
+			}
+			mesh_o.vert[v].N() = vcg::Point3f(sum.x, sum.y, sum.z);
+		}
+	});
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+class MeshModel;
+
+// how the faces around a vertex contribute to its normal
+enum class NormalWeighting
+{
+	// by their area, as vcg's PerVertexNormalizedPerFace
+	area,
+	// by the angle of their corner at the vertex
+	angle,
+};
+
+// normalized face normals, then vertex normals gathered from the faces around each vertex: every face and
+// every vertex is written by one thread only, so the result does not depend on thread_count.
+void update_normals(MeshModel& mesh_model, NormalWeighting weighting, unsigned int thread_count = 1);
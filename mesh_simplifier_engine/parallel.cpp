@@ -0,0 +1,97 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+unsigned int worker_count(unsigned int thread_count, size_t count)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	return static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(thread_count, count)));
+}
+
+void parallel_for(size_t count, unsigned int thread_count, const std::function<void(size_t)>& body)
+{
+	std::atomic<size_t> next_index{0};
+	std::mutex exception_mutex;
+	std::exception_ptr p_exception;
+	auto worker = [&]
+	{
+		try
+		{
+			for (size_t i = next_index++; i < count; i = next_index++)
+			{
+				body(i);
+			}
+		}
+		catch (...)
+		{
+			// the remaining indices are skipped; the first exception reaches the caller
+			next_index = count;
+
+			std::lock_guard<std::mutex> lock(exception_mutex);
+			if (!p_exception)
+			{
+				p_exception = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < worker_count(thread_count, count); ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (p_exception)
+	{
+		std::rethrow_exception(p_exception);
+	}
+}
+
+void parallel_for_chunks(size_t count, size_t chunk_size, unsigned int thread_count,
+                         const std::function<void(size_t, size_t)>& body)
+{
+	const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	parallel_for(chunk_count, thread_count, [&](size_t chunk)
+	{
+		body(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+	});
+}
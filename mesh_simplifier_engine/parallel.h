@@ -0,0 +1,76 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// resolves a requested thread count: 0 means one thread per hardware thread, and never more than count.
+unsigned int worker_count(unsigned int thread_count, size_t count);
+
+// calls body(i) for every i in [0, count), handing out indices one at a time to worker_count threads.
+// the calling thread is one of the workers. an exception thrown by body stops handing out indices and is
+// rethrown on the calling thread once every worker has finished.
+void parallel_for(size_t count, unsigned int thread_count, const std::function<void(size_t)>& body);
+
+// calls body(begin, end) for consecutive ranges of at most chunk_size indices covering [0, count), the ranges
+// handed out to worker_count threads like the indices of parallel_for.
+void parallel_for_chunks(size_t count, size_t chunk_size, unsigned int thread_count,
+                         const std::function<void(size_t, size_t)>& body);
+
+// sorts one block per worker in parallel, then merges the blocks pairwise, the merges of a round in parallel.
+// compare has to be a strict total order for the result not to depend on thread_count.
+template <typename Value, typename Compare>
+void parallel_sort(std::vector<Value>& values, size_t min_block_size, unsigned int thread_count, Compare compare)
+{
+	const size_t count = values.size();
+	const unsigned int workers = worker_count(thread_count, (count + min_block_size - 1) / min_block_size);
+	if (workers <= 1)
+	{
+		std::sort(values.begin(), values.end(), compare);
+		return;
+	}
+
+	const size_t block_size = (count + workers - 1) / workers;
+	parallel_for(workers, workers, [&](size_t block)
+	{
+		const size_t begin = std::min(count, block * block_size);
+		const size_t end = std::min(count, begin + block_size);
+		std::sort(values.begin() + begin, values.begin() + end, compare);
+	});
+
+	for (size_t width = block_size; width < count; width *= 2)
+	{
+		const size_t merge_count = (count + 2 * width - 1) / (2 * width);
+		parallel_for(merge_count, thread_count, [&](size_t merge)
+		{
+			const size_t begin = merge * 2 * width;
+			const size_t middle = std::min(count, begin + width);
+			const size_t end = std::min(count, begin + 2 * width);
+			std::inplace_merge(values.begin() + begin, values.begin() + middle, values.begin() + end, compare);
+		});
+	}
+}
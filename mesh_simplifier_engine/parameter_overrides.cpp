@@ -0,0 +1,384 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "parameter_overrides.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+namespace
+{
+	using FieldSetter = std::function<bool(const QJsonValue&, SimplifyOptions&)>;
+
+	struct OptionField
+	{
+		const char* name;
+		FieldSetter set;
+	};
+
+	FieldSetter number_field(float SimplifyOptions::* p_field, double minimum, double maximum,
+	                         bool minimum_inclusive = true)
+	{
+		return [=](const QJsonValue& value, SimplifyOptions& options)
+		{
+			const double number = value.toDouble();
+			if (!value.isDouble() || number > maximum || number < minimum || (!minimum_inclusive && number == minimum))
+			{
+				return false;
+			}
+			options.*p_field = static_cast<float>(number);
+
+			return true;
+		};
+	}
+
+	FieldSetter bool_field(bool SimplifyOptions::* p_field)
+	{
+		return [=](const QJsonValue& value, SimplifyOptions& options)
+		{
+			if (!value.isBool())
+			{
+				return false;
+			}
+			options.*p_field = value.toBool();
+
+			return true;
+		};
+	}
+
+	const std::vector<OptionField>& option_fields()
+	{
+		static const std::vector<OptionField> fields = {
+			{"target_face_ratio", number_field(&SimplifyOptions::target_face_ratio, 0.0, 1.0, false)},
+			{"quality_threshold", number_field(&SimplifyOptions::quality_threshold, 0.0, 1.0)},
+			{
+				"texture_quality", [](const QJsonValue& value, SimplifyOptions& options)
+				{
+					const double number = value.toDouble();
+					if (!value.isDouble() || number < 0 || number > 100)
+					{
+						return false;
+					}
+					options.texture_quality = static_cast<int>(number);
+
+					return true;
+				}
+			},
+			{"preserve_boundary", bool_field(&SimplifyOptions::preserve_boundary)},
+			{"boundary_weight", number_field(&SimplifyOptions::boundary_weight, 0.0, 1e6, false)},
+			{"preserve_normal", bool_field(&SimplifyOptions::preserve_normal)},
+			{"preserve_topology", bool_field(&SimplifyOptions::preserve_topology)},
+			{"optimal_placement", bool_field(&SimplifyOptions::optimal_placement)},
+			{"planar_quadric", bool_field(&SimplifyOptions::planar_quadric)},
+			{"planar_weight", number_field(&SimplifyOptions::planar_weight, 0.0, 1e6)},
+			{"quality_weight", bool_field(&SimplifyOptions::quality_weight)},
+			{"auto_clean", bool_field(&SimplifyOptions::auto_clean)},
+			{
+				"deadline_seconds", [](const QJsonValue& value, SimplifyOptions& options)
+				{
+					if (!value.isDouble() || value.toDouble() < 0)
+					{
+						return false;
+					}
+					options.deadline_seconds = value.toDouble();
+
+					return true;
+				}
+			},
+		};
+
+		return fields;
+	}
+
+	bool read_json_object(const std::filesystem::path& file_path, QJsonObject& object, std::string& error)
+	{
+		QFile file(QString::fromUtf8(file_path.generic_string().c_str()));
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			error = "unable to open " + file_path.generic_string();
+
+			return false;
+		}
+
+		QJsonParseError parse_error;
+		const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parse_error);
+		if (parse_error.error != QJsonParseError::NoError)
+		{
+			error = file_path.generic_string() + " : " + parse_error.errorString().toStdString();
+
+			return false;
+		}
+		if (!document.isObject())
+		{
+			error = file_path.generic_string() + " : not a json object";
+
+			return false;
+		}
+		object = document.object();
+
+		return true;
+	}
+
+	std::string format_sweep_value(const QJsonValue& value)
+	{
+		if (value.isBool())
+		{
+			return value.toBool() ? "true" : "false";
+		}
+
+		std::ostringstream stream;
+		stream << value.toDouble();
+
+		return stream.str();
+	}
+}
+
+bool ParameterOverrides::load(const std::filesystem::path& config_file_path, DecimationEngine engine,
+                              std::string& error)
+{
+	QJsonObject config;
+	if (!read_json_object(config_file_path, config, error))
+	{
+		return false;
+	}
+
+	std::vector<Rule> rules;
+	for (const QJsonValue& value : config.value("rules").toArray())
+	{
+		const QJsonObject rule_object = value.toObject();
+
+		Rule rule;
+		rule.glob = rule_object.value("glob").toString().toStdString();
+		if (rule.glob.empty())
+		{
+			error = config_file_path.generic_string() + " : a rule without a glob";
+
+			return false;
+		}
+		rule.pattern = glob_to_regex(rule.glob);
+		rule.options = rule_object.value("options").toObject();
+
+		// validated once here, so resolving a file can only fail on its sidecar
+		SimplifyOptions validated;
+		validated.engine = engine;
+		std::string option_error;
+		if (!apply_option_overrides(rule.options, validated, option_error))
+		{
+			error = config_file_path.generic_string() + " : rule " + rule.glob + " : " + option_error;
+
+			return false;
+		}
+
+		rules.push_back(std::move(rule));
+	}
+	rules_ = std::move(rules);
+
+	return true;
+}
+
+size_t ParameterOverrides::rule_count() const
+{
+	return rules_.size();
+}
+
+bool ParameterOverrides::resolve(const std::filesystem::path& input_file_path, const std::string& relative_path,
+                                 SimplifyOptions& options, std::vector<std::string>& sources,
+                                 std::string& error) const
+{
+	for (const Rule& rule : rules_)
+	{
+		if (std::regex_match(relative_path, rule.pattern) && apply_option_overrides(rule.options, options, error))
+		{
+			sources.push_back("rule " + rule.glob);
+		}
+	}
+
+	const std::filesystem::path sidecar_path = sidecar_file_path(input_file_path);
+	std::error_code exists_error;
+	if (!exists(sidecar_path, exists_error))
+	{
+		return true;
+	}
+
+	QJsonObject sidecar;
+	if (!read_json_object(sidecar_path, sidecar, error))
+	{
+		return false;
+	}
+	if (!apply_option_overrides(sidecar, options, error))
+	{
+		error = sidecar_path.generic_string() + " : " + error;
+
+		return false;
+	}
+	sources.push_back("sidecar");
+
+	return true;
+}
+
+std::filesystem::path sidecar_file_path(const std::filesystem::path& input_file_path)
+{
+	std::filesystem::path result = input_file_path;
+	result += ".simplify.json";
+
+	return result;
+}
+
+std::regex glob_to_regex(const std::string& glob)
+{
+	std::string pattern;
+	for (size_t i = 0; i < glob.size(); ++i)
+	{
+		const char c = glob[i];
+		if (c == '*' && i + 1 < glob.size() && glob[i + 1] == '*')
+		{
+			++i;
+			if (i + 1 < glob.size() && glob[i + 1] == '/')
+			{
+				++i;
+				pattern += "(?:.*/)?";
+			}
+			else
+			{
+				pattern += ".*";
+			}
+		}
+		else if (c == '*')
+		{
+			pattern += "[^/]*";
+		}
+		else if (c == '?')
+		{
+			pattern += "[^/]";
+		}
+		else
+		{
+			if (std::string("\\^$.|+()[]{}").find(c) != std::string::npos)
+			{
+				pattern += '\\';
+			}
+			pattern += c;
+		}
+	}
+
+	return std::regex(pattern, std::regex::ECMAScript | std::regex::icase);
+}
+
+bool apply_option_overrides(const QJsonObject& object, SimplifyOptions& options, std::string& error)
+{
+	SimplifyOptions result = options;
+	for (const QString& key : object.keys())
+	{
+		const std::string name = key.toStdString();
+
+		const auto& fields = option_fields();
+		const auto field = std::find_if(fields.begin(), fields.end(), [&name](const OptionField& candidate)
+		{
+			return name == candidate.name;
+		});
+		if (field == fields.end())
+		{
+			error = "unknown option " + name;
+
+			return false;
+		}
+		if (!field->set(object.value(key), result))
+		{
+			error = "invalid value for " + name;
+
+			return false;
+		}
+	}
+	// the in-tree engines decimate an IndexedMesh, which carries no vertex quality to weight by
+	if (result.quality_weight && result.engine != DecimationEngine::filter)
+	{
+		error = "quality_weight needs the filter engine";
+
+		return false;
+	}
+	options = result;
+
+	return true;
+}
+
+bool load_sweep_grid(const std::filesystem::path& grid_file_path, DecimationEngine engine,
+                     std::vector<SweepVariant>& variants, std::string& error)
+{
+	QJsonObject grid;
+	if (!read_json_object(grid_file_path, grid, error))
+	{
+		return false;
+	}
+
+	std::vector<SweepVariant> result(1);
+	for (const QString& key : grid.keys())
+	{
+		const QJsonArray values = grid.value(key).toArray();
+		if (values.isEmpty())
+		{
+			error = grid_file_path.generic_string() + " : " + key.toStdString() + " needs a non-empty array";
+
+			return false;
+		}
+
+		std::vector<SweepVariant> expanded;
+		for (const SweepVariant& variant : result)
+		{
+			for (const QJsonValue& value : values)
+			{
+				SweepVariant next = variant;
+				next.name += (next.name.empty() ? "" : "_") + key.toStdString() + "-" + format_sweep_value(value);
+				next.settings.insert(key, value);
+				expanded.push_back(std::move(next));
+			}
+		}
+		result = std::move(expanded);
+	}
+
+	for (const SweepVariant& variant : result)
+	{
+		SimplifyOptions validated;
+		validated.engine = engine;
+		if (!apply_option_overrides(variant.settings, validated, error))
+		{
+			error = grid_file_path.generic_string() + " : " + error;
+
+			return false;
+		}
+	}
+	if (result.size() == 1 && result.front().name.empty())
+	{
+		error = grid_file_path.generic_string() + " : empty grid";
+
+		return false;
+	}
+
+	variants = std::move(result);
+
+	return true;
+}
@@ -0,0 +1,80 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "simplifier_engine.h"
+
+#include <QJsonObject>
+
+#include <filesystem>
+#include <regex>
+#include <string>
+#include <vector>
+
+// per-file simplification settings layered over the command line ones: the glob rules of a config file in
+// order, then the sidecar next to the model (model.obj.simplify.json), so the most specific setting wins.
+// both use the SimplifyOptions field names as keys, e.g. {"target_face_ratio": 0.8, "preserve_topology": true}.
+class ParameterOverrides
+{
+public:
+	// {"rules": [{"glob": "hero/**", "options": {...}}, ...]}, validated for the engine the files run with
+	bool load(const std::filesystem::path& config_file_path, DecimationEngine engine, std::string& error);
+
+	size_t rule_count() const;
+
+	// relative_path is matched against the globs with '/' separators. sources names what was applied.
+	bool resolve(const std::filesystem::path& input_file_path, const std::string& relative_path,
+	             SimplifyOptions& options, std::vector<std::string>& sources, std::string& error) const;
+
+private:
+	struct Rule
+	{
+		std::string glob;
+		std::regex pattern;
+		QJsonObject options;
+	};
+
+	std::vector<Rule> rules_;
+};
+
+std::filesystem::path sidecar_file_path(const std::filesystem::path& input_file_path);
+
+// '*' and '?' stay within a path segment, "**" spans segments and "**/" also matches no directory at all.
+std::regex glob_to_regex(const std::string& glob);
+
+// sets the options named in object; fails on unknown keys, out of range values and options the engine of
+// options does not implement (quality_weight with the in-tree engines).
+bool apply_option_overrides(const QJsonObject& object, SimplifyOptions& options, std::string& error);
+
+struct SweepVariant
+{
+	// "key-value" pairs joined by '_', usable as a directory name
+	std::string name;
+	QJsonObject settings;
+};
+
+// expands {"quality_threshold": [0.2, 0.3], "planar_weight": [0.001, 0.01]} into the cartesian product of the
+// listed values, validating every variant for engine.
+bool load_sweep_grid(const std::filesystem::path& grid_file_path, DecimationEngine engine,
+                     std::vector<SweepVariant>& variants, std::string& error);
@@ -0,0 +1,262 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "point_cloud.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	constexpr size_t chunk_size = 4096;
+	// bits per axis of the morton codes, the finest grid level
+	constexpr int morton_bits = 21;
+	// a header longer than this is not read to its end
+	constexpr size_t max_header_lines = 1024;
+
+	struct MortonPoint
+	{
+		std::uint64_t code;
+		std::uint32_t vertex;
+
+		bool operator<(const MortonPoint& other) const
+		{
+			return (code != other.code) ? code < other.code : vertex < other.vertex;
+		}
+	};
+
+	// the low morton_bits bits of value, moved to every third bit
+	std::uint64_t spread_bits(std::uint64_t value)
+	{
+		value &= 0x1fffff;
+		value = (value | value << 32) & 0x1f00000000ffffull;
+		value = (value | value << 16) & 0x1f0000ff0000ffull;
+		value = (value | value << 8) & 0x100f00f00f00f00full;
+		value = (value | value << 4) & 0x10c30c30c30c30c3ull;
+		value = (value | value << 2) & 0x1249249249249249ull;
+
+		return value;
+	}
+
+	// codes of the live vertices on a grid of 2^morton_bits cubic cells along the longest side of their bounds
+	std::vector<MortonPoint> morton_points(const IndexedMesh& cloud, unsigned int thread_count)
+	{
+		std::vector<MortonPoint> result;
+		result.reserve(cloud.live_vertex_count());
+
+		Vector3d low(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+		             std::numeric_limits<double>::max());
+		Vector3d high = low * -1.0;
+		for (size_t v = 0; v < cloud.vertex_count(); ++v)
+		{
+			if (cloud.is_vertex_removed(v))
+			{
+				continue;
+			}
+
+			const auto& p = cloud.positions[v];
+			low = {std::min<double>(low.x, p[0]), std::min<double>(low.y, p[1]), std::min<double>(low.z, p[2])};
+			high = {std::max<double>(high.x, p[0]), std::max<double>(high.y, p[1]), std::max<double>(high.z, p[2])};
+			result.push_back({0, static_cast<std::uint32_t>(v)});
+		}
+		if (result.empty())
+		{
+			return result;
+		}
+
+		const double extent = std::max({high.x - low.x, high.y - low.y, high.z - low.z});
+		const double cell_max = static_cast<double>((1u << morton_bits) - 1);
+		const double scale = (extent > 0.0) ? cell_max / extent : 0.0;
+		parallel_for_chunks(result.size(), chunk_size, thread_count, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const Vector3d d = (Vector3d(cloud.positions[result[i].vertex]) - low) * scale;
+				result[i].code = spread_bits(static_cast<std::uint64_t>(std::min(d.x, cell_max))) |
+					spread_bits(static_cast<std::uint64_t>(std::min(d.y, cell_max))) << 1 |
+					spread_bits(static_cast<std::uint64_t>(std::min(d.z, cell_max))) << 2;
+			}
+		});
+
+		return result;
+	}
+
+	// whether sorted point i starts a cell of the level, whose cells are 2^level finest cells wide
+	bool starts_cell(const std::vector<MortonPoint>& points, size_t i, int level)
+	{
+		return i == 0 || (points[i].code >> (3 * level)) != (points[i - 1].code >> (3 * level));
+	}
+}
+
+bool is_point_cloud_file(const std::filesystem::path& file_path)
+{
+	std::ifstream stream(file_path, std::ios::binary);
+	std::string line;
+	if (!std::getline(stream, line) || line.compare(0, 3, "ply") != 0)
+	{
+		return false;
+	}
+
+	long long vertex_count = 0;
+	long long face_count = 0;
+	for (size_t i = 0; i < max_header_lines && std::getline(stream, line); ++i)
+	{
+		if (line.compare(0, 10, "end_header") == 0)
+		{
+			return vertex_count > 0 && face_count == 0;
+		}
+
+		std::istringstream words(line);
+		std::string keyword;
+		std::string element;
+		long long count = 0;
+		if (words >> keyword >> element >> count && keyword == "element")
+		{
+			if (element == "vertex")
+			{
+				vertex_count = count;
+			}
+			else if (element == "face" || element == "tristrips")
+			{
+				face_count += count;
+			}
+		}
+	}
+
+	return false;
+}
+
+size_t decimate_point_cloud(IndexedMesh& cloud, size_t target_count, unsigned int thread_count)
+{
+	// a cloud is never reduced to nothing
+	target_count = std::max<size_t>(target_count, 1);
+
+	std::vector<MortonPoint> points = morton_points(cloud, thread_count);
+	const size_t count = points.size();
+	if (count <= target_count)
+	{
+		return 0;
+	}
+	parallel_sort(points, chunk_size, thread_count, std::less<MortonPoint>());
+
+	// occupied cells per level, counted per chunk in one scan
+	const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+	std::vector<std::array<size_t, morton_bits + 1>> chunk_cells(chunk_count);
+	parallel_for_chunks(count, chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		auto& cells = chunk_cells[begin / chunk_size];
+		cells.fill(0);
+		for (size_t i = begin; i < end; ++i)
+		{
+			for (int level = 0; level <= morton_bits; ++level)
+			{
+				if (!starts_cell(points, i, level))
+				{
+					break;
+				}
+				++cells[level];
+			}
+		}
+	});
+	std::array<size_t, morton_bits + 1> level_cells{};
+	for (const auto& cells : chunk_cells)
+	{
+		for (int level = 0; level <= morton_bits; ++level)
+		{
+			level_cells[level] += cells[level];
+		}
+	}
+
+	// the coarsest level with enough cells; below it the finest, when duplicates leave too few cells overall
+	int level = 0;
+	while (level < morton_bits && level_cells[level + 1] >= target_count)
+	{
+		++level;
+	}
+	const size_t cell_count = level_cells[level];
+	const size_t kept_count = std::min(target_count, cell_count);
+
+	// the first cell of every chunk, from prefix sums of the per-chunk counts
+	std::vector<size_t> chunk_first_cell(chunk_count + 1, 0);
+	for (size_t c = 0; c < chunk_count; ++c)
+	{
+		chunk_first_cell[c + 1] = chunk_first_cell[c] + chunk_cells[c][level];
+	}
+
+	cloud.vertex_removed.resize(cloud.vertex_count(), 0);
+	parallel_for_chunks(count, chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		size_t cell = chunk_first_cell[begin / chunk_size];
+		for (size_t start = begin; start < end; ++start)
+		{
+			if (!starts_cell(points, start, level))
+			{
+				continue;
+			}
+
+			size_t stop = start + 1;
+			while (stop < count && !starts_cell(points, stop, level))
+			{
+				++stop;
+			}
+
+			// cell is kept when the evenly spaced ranks step over it
+			const bool kept = (cell + 1) * kept_count / cell_count != cell * kept_count / cell_count;
+			++cell;
+
+			Vector3d mean;
+			for (size_t i = start; i < stop; ++i)
+			{
+				mean = mean + Vector3d(cloud.positions[points[i].vertex]);
+			}
+			mean = mean * (1.0 / (stop - start));
+
+			size_t nearest = start;
+			double nearest_distance = std::numeric_limits<double>::max();
+			for (size_t i = start; i < stop; ++i)
+			{
+				const double distance = (Vector3d(cloud.positions[points[i].vertex]) - mean).squared_length();
+				if (distance < nearest_distance)
+				{
+					nearest = i;
+					nearest_distance = distance;
+				}
+			}
+			for (size_t i = start; i < stop; ++i)
+			{
+				if (!kept || i != nearest)
+				{
+					cloud.vertex_removed[points[i].vertex] = 1;
+				}
+			}
+		}
+	});
+
+	return count - kept_count;
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+
+#include <filesystem>
+
+// true for a ply whose header declares vertices but neither faces nor triangle strips. reads the header only.
+bool is_point_cloud_file(const std::filesystem::path& file_path);
+
+// flags all but target_count of the live vertices as removed, thinning the densest regions first (a voxel
+// grid subsampling): the points are sorted along a morton curve of their bounds, the coarsest grid level with
+// at least target_count occupied cells is chosen, and target_count of its cells, evenly spaced along the curve,
+// each keep the point nearest the mean of their points. the kept points are original ones, so their colors and
+// normals stay as they were. a target of 0 keeps one point. the sort and the scans run in parallel; the result
+// does not depend on thread_count. returns the removed count.
+size_t decimate_point_cloud(IndexedMesh& cloud, size_t target_count, unsigned int thread_count = 1);
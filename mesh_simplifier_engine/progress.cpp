@@ -0,0 +1,210 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "progress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <mutex>
+
+namespace
+{
+	// log at most every few seconds, or when the filter has advanced by a step
+	constexpr std::chrono::seconds log_interval(5);
+	constexpr int log_percent_step = 10;
+
+	std::atomic<bool> interrupted{false};
+
+	thread_local ProgressScope* p_current_scope = nullptr;
+
+	std::atomic<int> next_worker_id{1};
+	thread_local const int worker_id = next_worker_id.fetch_add(1);
+
+	std::mutex workers_mutex;
+	std::vector<WorkerStatus> workers;
+
+	void publish(const WorkerStatus& status)
+	{
+		std::lock_guard<std::mutex> lock(workers_mutex);
+
+		auto it = std::find_if(workers.begin(), workers.end(), [&](const WorkerStatus& worker)
+		{
+			return worker.worker_id == status.worker_id;
+		});
+		if (it == workers.end())
+		{
+			workers.push_back(status);
+		}
+		else
+		{
+			*it = status;
+		}
+	}
+
+	void retire(int id)
+	{
+		std::lock_guard<std::mutex> lock(workers_mutex);
+
+		workers.erase(std::remove_if(workers.begin(), workers.end(), [&](const WorkerStatus& worker)
+		{
+			return worker.worker_id == id;
+		}), workers.end());
+	}
+
+	void on_interrupt(int)
+	{
+		interrupted = true;
+	}
+
+	double seconds_between(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+	{
+		return std::chrono::duration<double>(to - from).count();
+	}
+}
+
+ProgressScope::ProgressScope(std::string file, double deadline_seconds, LogFunction log)
+	: file_(std::move(file)), log_(std::move(log)), start_(std::chrono::steady_clock::now()), last_log_(start_),
+	  p_previous_(p_current_scope)
+{
+	if (0.0 < deadline_seconds)
+	{
+		has_deadline_ = true;
+		deadline_ = start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(deadline_seconds));
+	}
+
+	p_current_scope = this;
+	publish(status(0));
+}
+
+ProgressScope::~ProgressScope()
+{
+	p_current_scope = p_previous_;
+	retire(worker_id);
+}
+
+bool ProgressScope::callback(const int pos, const char* str)
+{
+	if (p_current_scope == nullptr)
+	{
+		return !interrupted;
+	}
+
+	return p_current_scope->update(pos, str);
+}
+
+bool ProgressScope::update(int pos, const char* str)
+{
+	// the filter calls back about every 0.1 s and the in-tree decimator every 1024 collapses,
+	// rarely enough to read the clock on every call
+	percent_ = std::clamp(pos, 0, 100);
+
+	const bool percent_step = last_logged_percent_ + log_percent_step <= percent_;
+	const auto now = std::chrono::steady_clock::now();
+	if (interrupted)
+	{
+		cancel_reason_ = "interrupted";
+	}
+	else if (has_deadline_ && deadline_ <= now)
+	{
+		cancel_reason_ = "deadline exceeded";
+	}
+	if (cancelled())
+	{
+		throw OperationCancelled(cancel_reason_);
+	}
+
+	if (percent_step || log_interval <= now - last_log_)
+	{
+		const WorkerStatus current_status = status(percent_);
+		publish(current_status);
+
+		if (log_)
+		{
+			std::string message = "progress : " + format_worker_status(current_status);
+			if (str != nullptr && *str != '\0')
+			{
+				message += " (";
+				message += str;
+				message += ")";
+			}
+			log_(message);
+		}
+
+		last_log_ = now;
+		last_logged_percent_ = percent_ - percent_ % log_percent_step;
+	}
+
+	return true;
+}
+
+WorkerStatus ProgressScope::status(int percent) const
+{
+	WorkerStatus result;
+	result.worker_id = worker_id;
+	result.file = file_;
+	result.percent = percent;
+	result.elapsed_seconds = seconds_between(start_, std::chrono::steady_clock::now());
+	if (0 < percent)
+	{
+		result.eta_seconds = result.elapsed_seconds * (100 - percent) / percent;
+	}
+
+	return result;
+}
+
+void install_interrupt_handler()
+{
+	std::signal(SIGINT, on_interrupt);
+}
+
+bool interrupt_requested()
+{
+	return interrupted;
+}
+
+std::vector<WorkerStatus> active_workers()
+{
+	std::lock_guard<std::mutex> lock(workers_mutex);
+
+	return workers;
+}
+
+std::string format_worker_status(const WorkerStatus& status)
+{
+	char buffer[96];
+	if (0.0 <= status.eta_seconds)
+	{
+		std::snprintf(buffer, sizeof(buffer), "worker=%d %d%% elapsed=%.1fs eta=%.1fs", status.worker_id,
+		              status.percent, status.elapsed_seconds, status.eta_seconds);
+	}
+	else
+	{
+		std::snprintf(buffer, sizeof(buffer), "worker=%d %d%% elapsed=%.1fs eta=?", status.worker_id, status.percent,
+		              status.elapsed_seconds);
+	}
+
+	return std::string(buffer) + " file=" + status.file;
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// thrown from the filter callback to abort a running filter.
+// the quadric filter ignores the callback's return value, so unwinding is the only way out of its collapse loop.
+class OperationCancelled : public std::runtime_error
+{
+public:
+	explicit OperationCancelled(const std::string& reason)
+		: std::runtime_error(reason)
+	{
+	}
+};
+
+// snapshot of what a worker is currently doing.
+struct WorkerStatus
+{
+	int worker_id = 0;
+	std::string file;
+	int percent = 0;
+	double elapsed_seconds = 0.0;
+	// estimated seconds left, negative while unknown
+	double eta_seconds = -1.0;
+};
+
+// routes the progress of the filter running on the current thread to throttled log lines,
+// and cancels it on deadline or on interrupt. one scope per file and thread.
+class ProgressScope
+{
+public:
+	using LogFunction = std::function<void(const std::string&)>;
+
+	// deadline_seconds <= 0 means no deadline.
+	ProgressScope(std::string file, double deadline_seconds, LogFunction log);
+	~ProgressScope();
+
+	ProgressScope(const ProgressScope&) = delete;
+	ProgressScope& operator=(const ProgressScope&) = delete;
+
+	bool cancelled() const
+	{
+		return !cancel_reason_.empty();
+	}
+
+	const std::string& cancel_reason() const
+	{
+		return cancel_reason_;
+	}
+
+	// vcg::CallBackPos compatible entry point, dispatched to the scope of the calling thread.
+	static bool callback(const int pos, const char* str);
+
+private:
+	bool update(int pos, const char* str);
+	WorkerStatus status(int percent) const;
+
+	std::string file_;
+	LogFunction log_;
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point deadline_;
+	bool has_deadline_ = false;
+
+	std::chrono::steady_clock::time_point last_log_;
+	int last_logged_percent_ = 0;
+	int percent_ = 0;
+	std::string cancel_reason_;
+
+	ProgressScope* p_previous_ = nullptr;
+};
+
+// installs a SIGINT handler that asks running filters to cancel and the batch to stop.
+void install_interrupt_handler();
+bool interrupt_requested();
+
+// status of every thread currently inside a ProgressScope.
+std::vector<WorkerStatus> active_workers();
+
+std::string format_worker_status(const WorkerStatus& status);
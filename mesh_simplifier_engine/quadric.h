@@ -0,0 +1,110 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+
+#include <cmath>
+
+// symmetric 4x4 error quadric of garland and heckbert, the sum of squared distances to a set of planes.
+struct Quadric
+{
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+
+	// the plane n.p + d = 0, n of unit length
+	static Quadric from_plane(const Vector3d& n, double d, double weight = 1.0)
+	{
+		Quadric q;
+		q.a2 = weight * n.x * n.x;
+		q.ab = weight * n.x * n.y;
+		q.ac = weight * n.x * n.z;
+		q.ad = weight * n.x * d;
+		q.b2 = weight * n.y * n.y;
+		q.bc = weight * n.y * n.z;
+		q.bd = weight * n.y * d;
+		q.c2 = weight * n.z * n.z;
+		q.cd = weight * n.z * d;
+		q.d2 = weight * d * d;
+
+		return q;
+	}
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		a2 += other.a2;
+		ab += other.ab;
+		ac += other.ac;
+		ad += other.ad;
+		b2 += other.b2;
+		bc += other.bc;
+		bd += other.bd;
+		c2 += other.c2;
+		cd += other.cd;
+		d2 += other.d2;
+
+		return *this;
+	}
+
+	Quadric operator+(const Quadric& other) const
+	{
+		Quadric sum = *this;
+		return sum += other;
+	}
+
+	double evaluate(const Vector3d& p) const
+	{
+		return a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x
+		     + b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y
+		     + c2 * p.z * p.z + 2.0 * cd * p.z
+		     + d2;
+	}
+
+	// the point of least error, false when the quadric is (nearly) singular.
+	bool minimizer(Vector3d& p) const
+	{
+		const double m00 = b2 * c2 - bc * bc;
+		const double m01 = ac * bc - ab * c2;
+		const double m02 = ab * bc - ac * b2;
+		const double det = a2 * m00 + ab * m01 + ac * m02;
+
+		const double scale = std::abs(a2) + std::abs(b2) + std::abs(c2);
+		if (std::abs(det) <= 1e-12 * scale * scale * scale)
+		{
+			return false;
+		}
+
+		const double m11 = a2 * c2 - ac * ac;
+		const double m12 = ab * ac - a2 * bc;
+		const double m22 = a2 * b2 - ab * ab;
+
+		p.x = -(m00 * ad + m01 * bd + m02 * cd) / det;
+		p.y = -(m01 * ad + m11 * bd + m12 * cd) / det;
+		p.z = -(m02 * ad + m12 * bd + m22 * cd) / det;
+
+		return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+	}
+};
@@ -0,0 +1,136 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "quadric_cache.h"
+
+#include <fstream>
+#include <thread>
+
+namespace
+{
+	constexpr char state_magic[8] = {'M', 'S', 'Q', 'U', 'A', 'D', '\0', '\0'};
+	constexpr std::uint32_t state_version = 1;
+
+	// followed by vertex_count quadrics and collapse_count collapses
+	struct StateHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t reserved;
+
+		std::uint64_t geometry_hash;
+		std::uint64_t quadric_key;
+		std::uint64_t cost_key;
+
+		std::uint64_t vertex_count;
+		std::uint64_t collapse_count;
+	};
+}
+
+QuadricStateKey quadric_state_key(const IndexedMesh& mesh, const DecimationSettings& settings)
+{
+	QuadricStateKey key;
+	key.geometry_hash = geometry_hash(mesh);
+	key.quadric_key = quadric_settings_key(settings);
+	key.cost_key = cost_settings_key(settings);
+
+	return key;
+}
+
+bool load_quadric_state(const std::filesystem::path& file_path, const IndexedMesh& mesh, const QuadricStateKey& key,
+                        QuadricState& state)
+{
+	std::ifstream stream(file_path, std::ios::in | std::ios::binary);
+	StateHeader header;
+	if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	if (std::char_traits<char>::compare(header.magic, state_magic, sizeof(state_magic)) != 0 ||
+		header.version != state_version || header.geometry_hash != key.geometry_hash ||
+		header.quadric_key != key.quadric_key || header.vertex_count != mesh.vertex_count())
+	{
+		return false;
+	}
+
+	state.quadrics.resize(header.vertex_count);
+	if (!stream.read(reinterpret_cast<char*>(state.quadrics.data()), header.vertex_count * sizeof(Quadric)))
+	{
+		return false;
+	}
+
+	state.collapses.clear();
+	if (header.cost_key == key.cost_key)
+	{
+		state.collapses.resize(header.collapse_count);
+		if (!stream.read(reinterpret_cast<char*>(state.collapses.data()), header.collapse_count * sizeof(EdgeCollapse)))
+		{
+			state.collapses.clear();
+		}
+	}
+
+	return true;
+}
+
+bool store_quadric_state(const std::filesystem::path& file_path, const QuadricStateKey& key, const QuadricState& state)
+{
+	StateHeader header{};
+	std::char_traits<char>::copy(header.magic, state_magic, sizeof(state_magic));
+	header.version = state_version;
+	header.geometry_hash = key.geometry_hash;
+	header.quadric_key = key.quadric_key;
+	header.cost_key = key.cost_key;
+	header.vertex_count = state.quadrics.size();
+	header.collapse_count = state.collapses.size();
+
+	std::error_code error;
+	create_directories(file_path.parent_path(), error);
+
+	// written aside and renamed like the mesh cache entries
+	std::filesystem::path temporary_file_path = file_path;
+	temporary_file_path += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream stream(temporary_file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(state.quadrics.data()), state.quadrics.size() * sizeof(Quadric));
+		stream.write(reinterpret_cast<const char*>(state.collapses.data()),
+		             state.collapses.size() * sizeof(EdgeCollapse));
+		if (!stream.flush())
+		{
+			stream.close();
+			std::filesystem::remove(temporary_file_path, error);
+
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary_file_path, file_path, error);
+	if (error)
+	{
+		std::filesystem::remove(temporary_file_path, error);
+
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "quadric_decimator.h"
+
+#include <cstdint>
+#include <filesystem>
+
+// what a persisted QuadricState was computed from. the quadrics stay valid while the geometry and the
+// quadric settings match; the collapse costs also need the cost settings to match.
+struct QuadricStateKey
+{
+	std::uint64_t geometry_hash = 0;
+	std::uint64_t quadric_key = 0;
+	std::uint64_t cost_key = 0;
+};
+
+QuadricStateKey quadric_state_key(const IndexedMesh& mesh, const DecimationSettings& settings);
+
+// false on a missing, stale or unreadable file. state.collapses is left empty when only the quadrics apply.
+bool load_quadric_state(const std::filesystem::path& file_path, const IndexedMesh& mesh, const QuadricStateKey& key,
+                        QuadricState& state);
+bool store_quadric_state(const std::filesystem::path& file_path, const QuadricStateKey& key, const QuadricState& state);
@@ -0,0 +1,986 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "quadric_decimator.h"
+
+#include "mesh_cache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace
+{
+	// collapses between progress reports, often enough for the deadline checks
+	constexpr size_t progress_interval = 1024;
+	// multiple choice decimation gives up after this many steps in a row without a valid candidate
+	constexpr size_t max_failed_steps = 1000;
+	// multiple choice decimation splits meshes into regions of about this many faces, and at most this many,
+	// independently of the thread count so the result does not depend on it
+	constexpr size_t region_face_count = 65536;
+	constexpr size_t max_region_count = 64;
+	// vertices or edges per task of the parallel initialisation
+	constexpr size_t chunk_size = 4096;
+
+	constexpr std::uint32_t no_vertex = std::numeric_limits<std::uint32_t>::max();
+
+	// the cheapest collapse on top. ties are broken by the vertices so a heap rebuilt from a persisted
+	// state collapses in the same order as the one it was saved from.
+	struct HeapOrder
+	{
+		template <typename Entry>
+		bool operator()(const Entry& left, const Entry& right) const
+		{
+			if (left.cost != right.cost)
+			{
+				return left.cost > right.cost;
+			}
+			return left.v0 != right.v0 ? left.v0 > right.v0 : left.v1 > right.v1;
+		}
+	};
+
+	// invalid collapses stay queued, last
+	float queued_cost(double cost)
+	{
+		return static_cast<float>(std::min(cost, static_cast<double>(FLT_MAX)));
+	}
+
+	// the plane through p0 and p1 perpendicular to the face of the given unit normal
+	Quadric edge_plane_quadric(const Vector3d& p0, const Vector3d& p1, const Vector3d& n, double weight)
+	{
+		Vector3d m = (p1 - p0).cross(n);
+		const double length = m.length();
+		if (length == 0.0)
+		{
+			return {};
+		}
+		m = m * (1.0 / length);
+
+		return Quadric::from_plane(m, -m.dot(p0), weight);
+	}
+}
+
+std::uint64_t quadric_settings_key(const DecimationSettings& settings)
+{
+	const double values[] = {
+		settings.preserve_boundary ? 1.0 : 0.0, settings.boundary_weight,
+		settings.planar_quadric ? 1.0 : 0.0, settings.planar_weight,
+	};
+
+	return fnv1a_64(values, sizeof(values));
+}
+
+std::uint64_t cost_settings_key(const DecimationSettings& settings)
+{
+	const double values[] = {
+		settings.quality_threshold, settings.preserve_normal ? 1.0 : 0.0, settings.optimal_placement ? 1.0 : 0.0,
+	};
+
+	return fnv1a_64(values, sizeof(values), quadric_settings_key(settings));
+}
+
+std::uint64_t decimation_settings_key(const DecimationSettings& settings)
+{
+	const std::uint64_t values[] = {
+		settings.target_face_count, settings.preserve_topology ? 1u : 0u, settings.candidate_count,
+		settings.memoryless ? 1u : 0u,
+	};
+
+	return fnv1a_64(values, sizeof(values), cost_settings_key(settings));
+}
+
+QuadricDecimator::QuadricDecimator(IndexedMesh& mesh, const DecimationSettings& settings)
+	: mesh_(mesh), settings_(settings), vertex_faces_(build_vertex_face_adjacency(mesh))
+{
+	mesh_.vertex_removed.resize(mesh_.vertex_count(), 0);
+	mesh_.face_removed.resize(mesh_.face_count(), 0);
+	live_face_count_ = mesh_.live_face_count();
+
+	vertex_times_.assign(mesh_.vertex_count(), 0);
+}
+
+void QuadricDecimator::initialize()
+{
+	if (!settings_.memoryless)
+	{
+		compute_quadrics();
+	}
+	if (settings_.candidate_count == 0)
+	{
+		build_heap(unique_edges());
+	}
+}
+
+bool QuadricDecimator::initialize(QuadricState state)
+{
+	const size_t vertex_count = mesh_.vertex_count();
+	if (state.quadrics.size() != (settings_.memoryless ? 0 : vertex_count))
+	{
+		return false;
+	}
+	for (const EdgeCollapse& collapse : state.collapses)
+	{
+		if (collapse.v0 >= vertex_count || collapse.v1 >= vertex_count || collapse.v0 == collapse.v1)
+		{
+			return false;
+		}
+	}
+
+	quadrics_ = std::move(state.quadrics);
+	if (settings_.candidate_count != 0)
+	{
+		return true;
+	}
+	if (state.collapses.empty())
+	{
+		build_heap(unique_edges());
+		return true;
+	}
+
+	heap_.clear();
+	heap_.reserve(state.collapses.size() + state.collapses.size() / 4);
+	for (const EdgeCollapse& collapse : state.collapses)
+	{
+		heap_.push_back({collapse.cost, collapse.v0, collapse.v1, 0});
+	}
+
+	// ascending costs already are a heap
+	if (!std::is_heap(heap_.begin(), heap_.end(), HeapOrder()))
+	{
+		std::make_heap(heap_.begin(), heap_.end(), HeapOrder());
+	}
+
+	return true;
+}
+
+QuadricState QuadricDecimator::initial_state() const
+{
+	QuadricState state;
+	state.quadrics = quadrics_;
+	state.collapses.reserve(heap_.size());
+	for (const HeapEntry& entry : heap_)
+	{
+		state.collapses.push_back({entry.cost, entry.v0, entry.v1});
+	}
+
+	std::sort(state.collapses.begin(), state.collapses.end(),
+	          [](const EdgeCollapse& left, const EdgeCollapse& right) { return HeapOrder()(right, left); });
+
+	return state;
+}
+
+void QuadricDecimator::decimate(const ProgressFunction& progress)
+{
+	if (settings_.candidate_count == 0)
+	{
+		decimate_greedy(progress);
+	}
+	else
+	{
+		decimate_randomized(progress);
+	}
+}
+
+size_t QuadricDecimator::collapse_count() const
+{
+	return collapse_count_;
+}
+
+void QuadricDecimator::decimate_greedy(const ProgressFunction& progress)
+{
+	const size_t start_face_count = live_face_count_;
+	const size_t target_face_count = settings_.target_face_count;
+
+	while (live_face_count_ > target_face_count && !heap_.empty())
+	{
+		std::pop_heap(heap_.begin(), heap_.end(), HeapOrder());
+		const HeapEntry entry = heap_.back();
+		heap_.pop_back();
+
+		if (mesh_.vertex_removed[entry.v0] || mesh_.vertex_removed[entry.v1]
+		    || entry.time < vertex_times_[entry.v0] || entry.time < vertex_times_[entry.v1])
+		{
+			continue;
+		}
+
+		// the neighbourhood may have moved since the entry was queued
+		Vector3d position;
+		const double cost = collapse_cost(entry.v0, entry.v1, position);
+		if (!std::isfinite(cost))
+		{
+			continue;
+		}
+		if (queued_cost(cost) > entry.cost)
+		{
+			heap_.push_back({queued_cost(cost), entry.v0, entry.v1, time_});
+			std::push_heap(heap_.begin(), heap_.end(), HeapOrder());
+			continue;
+		}
+		if (settings_.preserve_topology && !link_condition_holds(entry.v0, entry.v1))
+		{
+			continue;
+		}
+
+		live_face_count_ -= collapse(entry.v0, entry.v1, position);
+		++collapse_count_;
+		vertex_times_[entry.v0] = ++time_;
+		push_vertex_edges(entry.v0);
+
+		if (progress && collapse_count_ % progress_interval == 0 && start_face_count > target_face_count)
+		{
+			progress(static_cast<int>((start_face_count - live_face_count_) * 100 / (start_face_count - target_face_count)));
+		}
+	}
+}
+
+void QuadricDecimator::decimate_randomized(const ProgressFunction& progress)
+{
+	decimate_regions(progress);
+
+	const size_t start_face_count = live_face_count_;
+	const size_t target_face_count = settings_.target_face_count;
+
+	// fixed seed: the same input simplifies the same way on every run
+	std::mt19937 random;
+	std::uniform_int_distribution<size_t> face_distribution(0, mesh_.face_count() - 1);
+	size_t failed_steps = 0;
+
+	while (live_face_count_ > target_face_count && failed_steps < max_failed_steps)
+	{
+		double best_cost = std::numeric_limits<double>::infinity();
+		std::uint32_t best_v0 = 0;
+		std::uint32_t best_v1 = 0;
+		Vector3d best_position;
+
+		for (unsigned int i = 0; i < settings_.candidate_count; ++i)
+		{
+			size_t f = face_distribution(random);
+			while (mesh_.face_removed[f])
+			{
+				f = face_distribution(random);
+			}
+
+			const auto& face = mesh_.faces[f];
+			const size_t corner = random() % 3;
+			const std::uint32_t v0 = face[corner];
+			const std::uint32_t v1 = face[(corner + 1) % 3];
+
+			Vector3d position;
+			const double cost = collapse_cost(v0, v1, position);
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_v0 = v0;
+				best_v1 = v1;
+				best_position = position;
+			}
+		}
+
+		if (!std::isfinite(best_cost) || (settings_.preserve_topology && !link_condition_holds(best_v0, best_v1)))
+		{
+			++failed_steps;
+			continue;
+		}
+		failed_steps = 0;
+
+		live_face_count_ -= collapse(best_v0, best_v1, best_position);
+		++collapse_count_;
+
+		if (progress && collapse_count_ % progress_interval == 0)
+		{
+			progress(static_cast<int>((start_face_count - live_face_count_) * 100 / (start_face_count - target_face_count)));
+		}
+	}
+}
+
+struct QuadricDecimator::Region
+{
+	std::uint32_t index = 0;
+	std::vector<std::uint32_t> faces;
+	std::mt19937 random;
+	size_t live_face_count = 0;
+	size_t target_face_count = 0;
+	size_t failed_steps = 0;
+	// collapses and removed faces since the last progress report
+	size_t collapse_count = 0;
+	size_t removed_face_count = 0;
+
+	bool finished() const
+	{
+		return live_face_count <= target_face_count || failed_steps >= max_failed_steps;
+	}
+};
+
+std::vector<QuadricDecimator::Region> QuadricDecimator::partition_regions()
+{
+	const size_t region_count = std::min(max_region_count, live_face_count_ / region_face_count);
+	if (region_count < 2)
+	{
+		return {};
+	}
+
+	// slabs along the longest axis of the bounding box, of the same number of vertices each
+	std::array<float, 3> low = {FLT_MAX, FLT_MAX, FLT_MAX};
+	std::array<float, 3> high = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (const auto& position : mesh_.positions)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			low[i] = std::min(low[i], position[i]);
+			high[i] = std::max(high[i], position[i]);
+		}
+	}
+	int axis = 0;
+	for (int i = 1; i < 3; ++i)
+	{
+		if (high[i] - low[i] > high[axis] - low[axis])
+		{
+			axis = i;
+		}
+	}
+
+	std::vector<std::uint32_t> order(mesh_.vertex_count());
+	std::iota(order.begin(), order.end(), 0);
+	parallel_sort(order, chunk_size, settings_.thread_count, [&](std::uint32_t left, std::uint32_t right)
+	{
+		const float a = mesh_.positions[left][axis];
+		const float b = mesh_.positions[right][axis];
+		return a != b ? a < b : left < right;
+	});
+
+	vertex_regions_.resize(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		vertex_regions_[order[i]] = static_cast<std::uint32_t>(i * region_count / order.size());
+	}
+
+	// faces across a seam belong to no region and are left to the serial pass
+	std::vector<Region> regions(region_count);
+	for (size_t f = 0; f < mesh_.face_count(); ++f)
+	{
+		const auto& face = mesh_.faces[f];
+		const std::uint32_t region = vertex_regions_[face[0]];
+		if (!mesh_.face_removed[f] && vertex_regions_[face[1]] == region && vertex_regions_[face[2]] == region)
+		{
+			regions[region].faces.push_back(static_cast<std::uint32_t>(f));
+		}
+	}
+
+	const size_t start_face_count = live_face_count_;
+	for (size_t r = 0; r < region_count; ++r)
+	{
+		Region& region = regions[r];
+		region.index = static_cast<std::uint32_t>(r);
+		region.random.seed(static_cast<std::uint32_t>(r + 1));
+		region.live_face_count = region.faces.size();
+		region.target_face_count = region.faces.size() * settings_.target_face_count / start_face_count;
+	}
+
+	return regions;
+}
+
+void QuadricDecimator::decimate_regions(const ProgressFunction& progress)
+{
+	const size_t start_face_count = live_face_count_;
+	const size_t target_face_count = settings_.target_face_count;
+	if (start_face_count <= target_face_count)
+	{
+		return;
+	}
+
+	std::vector<Region> regions = partition_regions();
+	if (regions.empty())
+	{
+		return;
+	}
+
+	// no two regions share a face or a vertex of a face they may change, so they run without locks.
+	// the calling thread reports the progress between rounds.
+	bool finished = false;
+	while (!finished)
+	{
+		parallel_for(regions.size(), settings_.thread_count, [&](size_t r)
+		{
+			decimate_region(regions[r], progress_interval);
+		});
+
+		finished = true;
+		for (Region& region : regions)
+		{
+			collapse_count_ += region.collapse_count;
+			live_face_count_ -= region.removed_face_count;
+			region.collapse_count = 0;
+			region.removed_face_count = 0;
+			finished = finished && region.finished();
+		}
+
+		if (progress)
+		{
+			progress(static_cast<int>((start_face_count - live_face_count_) * 100 / (start_face_count - target_face_count)));
+		}
+	}
+
+	std::vector<std::uint32_t>().swap(vertex_regions_);
+}
+
+void QuadricDecimator::decimate_region(Region& region, size_t step_count)
+{
+	if (region.finished())
+	{
+		return;
+	}
+
+	std::uniform_int_distribution<size_t> face_distribution(0, region.faces.size() - 1);
+
+	for (size_t step = 0; step < step_count && !region.finished(); ++step)
+	{
+		double best_cost = std::numeric_limits<double>::infinity();
+		std::uint32_t best_v0 = 0;
+		std::uint32_t best_v1 = 0;
+		Vector3d best_position;
+
+		for (unsigned int i = 0; i < settings_.candidate_count; ++i)
+		{
+			size_t f = region.faces[face_distribution(region.random)];
+			while (mesh_.face_removed[f])
+			{
+				f = region.faces[face_distribution(region.random)];
+			}
+
+			const auto& face = mesh_.faces[f];
+			const size_t corner = region.random() % 3;
+			const std::uint32_t v0 = face[corner];
+			const std::uint32_t v1 = face[(corner + 1) % 3];
+			if (!region_owns(region.index, v0, v1))
+			{
+				continue;
+			}
+
+			Vector3d position;
+			const double cost = collapse_cost(v0, v1, position);
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_v0 = v0;
+				best_v1 = v1;
+				best_position = position;
+			}
+		}
+
+		if (!std::isfinite(best_cost) || (settings_.preserve_topology && !link_condition_holds(best_v0, best_v1)))
+		{
+			++region.failed_steps;
+			continue;
+		}
+		region.failed_steps = 0;
+
+		const size_t removed_face_count = collapse(best_v0, best_v1, best_position);
+		region.live_face_count -= removed_face_count;
+		region.removed_face_count += removed_face_count;
+		++region.collapse_count;
+	}
+}
+
+bool QuadricDecimator::region_owns(std::uint32_t region, std::uint32_t v0, std::uint32_t v1) const
+{
+	// the collapse reads and writes the faces around both vertices and the vertices of those faces
+	for (const std::uint32_t vertex : {v0, v1})
+	{
+		for (const std::uint32_t f : vertex_faces_[vertex])
+		{
+			if (mesh_.face_removed[f])
+			{
+				continue;
+			}
+
+			for (const std::uint32_t other : mesh_.faces[f])
+			{
+				if (vertex_regions_[other] != region)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void QuadricDecimator::gather_ring(std::uint32_t vertex, std::vector<std::uint32_t>& ring) const
+{
+	ring.clear();
+	for (const std::uint32_t f : vertex_faces_[vertex])
+	{
+		if (mesh_.face_removed[f])
+		{
+			continue;
+		}
+
+		for (const std::uint32_t other : mesh_.faces[f])
+		{
+			if (other != vertex)
+			{
+				ring.push_back(other);
+			}
+		}
+	}
+
+	std::sort(ring.begin(), ring.end());
+	ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+}
+
+std::vector<QuadricDecimator::Edge> QuadricDecimator::unique_edges() const
+{
+	// each vertex owns its edges to higher vertices: counted, then written at the prefix sum of the counts,
+	// so the vertices split across threads without a global sort
+	const size_t vertex_count = mesh_.vertex_count();
+	std::vector<size_t> offsets(vertex_count + 1, 0);
+
+	parallel_for_chunks(vertex_count, chunk_size, settings_.thread_count, [&](size_t begin, size_t end)
+	{
+		std::vector<std::uint32_t> ring;
+		for (size_t v = begin; v < end; ++v)
+		{
+			gather_ring(static_cast<std::uint32_t>(v), ring);
+			offsets[v + 1] = ring.end() - std::upper_bound(ring.begin(), ring.end(), static_cast<std::uint32_t>(v));
+		}
+	});
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	std::vector<Edge> edges(offsets.back());
+	parallel_for_chunks(vertex_count, chunk_size, settings_.thread_count, [&](size_t begin, size_t end)
+	{
+		std::vector<std::uint32_t> ring;
+		for (size_t v = begin; v < end; ++v)
+		{
+			gather_ring(static_cast<std::uint32_t>(v), ring);
+
+			size_t index = offsets[v];
+			for (auto it = std::upper_bound(ring.begin(), ring.end(), static_cast<std::uint32_t>(v)); it != ring.end(); ++it)
+			{
+				edges[index++] = {static_cast<std::uint32_t>(v), *it};
+			}
+		}
+	});
+
+	return edges;
+}
+
+void QuadricDecimator::compute_quadrics()
+{
+	// gathered per vertex from its faces instead of scattered from the faces, so no two threads write the
+	// same quadric
+	quadrics_.resize(mesh_.vertex_count());
+	parallel_for_chunks(mesh_.vertex_count(), chunk_size, settings_.thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			quadrics_[v] = local_quadric(static_cast<std::uint32_t>(v));
+		}
+	});
+}
+
+void QuadricDecimator::build_heap(const std::vector<Edge>& edges)
+{
+	// room for the entries pushed before the first purge, so the heap is never reallocated at twice the size
+	heap_.reserve(edges.size() + edges.size() / 4);
+	heap_.resize(edges.size());
+	parallel_for_chunks(edges.size(), chunk_size, settings_.thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Vector3d position;
+			const double cost = collapse_cost(edges[i].v0, edges[i].v1, position);
+			heap_[i] = {queued_cost(cost), edges[i].v0, edges[i].v1, 0};
+		}
+	});
+
+	std::make_heap(heap_.begin(), heap_.end(), HeapOrder());
+}
+
+Quadric QuadricDecimator::local_quadric(std::uint32_t vertex) const
+{
+	Quadric result;
+	// the other end of each edge of the vertex, with the face it was seen in
+	thread_local std::vector<std::pair<std::uint32_t, std::uint32_t>> ends;
+	ends.clear();
+
+	for (const std::uint32_t f : vertex_faces_[vertex])
+	{
+		if (mesh_.face_removed[f])
+		{
+			continue;
+		}
+
+		const auto& face = mesh_.faces[f];
+		const int corner = face[0] == vertex ? 0 : (face[1] == vertex ? 1 : 2);
+		const int next = (corner + 1) % 3;
+		const int previous = (corner + 2) % 3;
+		ends.emplace_back(face[next], f);
+		ends.emplace_back(face[previous], f);
+
+		const Vector3d p[3] = {Vector3d(mesh_.positions[face[0]]), Vector3d(mesh_.positions[face[1]]),
+		                       Vector3d(mesh_.positions[face[2]])};
+		Vector3d n = face_normal(p[0], p[1], p[2]);
+		const double length = n.length();
+		if (length == 0.0)
+		{
+			continue;
+		}
+		n = n * (1.0 / length);
+
+		result += Quadric::from_plane(n, -n.dot(p[0]));
+		if (settings_.planar_quadric)
+		{
+			result += edge_plane_quadric(p[corner], p[next], n, settings_.planar_weight);
+			result += edge_plane_quadric(p[previous], p[corner], n, settings_.planar_weight);
+		}
+	}
+
+	if (!settings_.preserve_boundary)
+	{
+		return result;
+	}
+
+	// an edge seen in a single face lies on the boundary
+	std::sort(ends.begin(), ends.end());
+	for (size_t i = 0; i < ends.size(); ++i)
+	{
+		const bool shared = (i > 0 && ends[i - 1].first == ends[i].first)
+		                 || (i + 1 < ends.size() && ends[i + 1].first == ends[i].first);
+		if (shared)
+		{
+			continue;
+		}
+
+		const auto& face = mesh_.faces[ends[i].second];
+		Vector3d n = face_normal(Vector3d(mesh_.positions[face[0]]), Vector3d(mesh_.positions[face[1]]),
+		                         Vector3d(mesh_.positions[face[2]]));
+		const double length = n.length();
+		if (length != 0.0)
+		{
+			result += edge_plane_quadric(Vector3d(mesh_.positions[vertex]), Vector3d(mesh_.positions[ends[i].first]),
+			                             n * (1.0 / length), settings_.boundary_weight);
+		}
+	}
+
+	return result;
+}
+
+Quadric QuadricDecimator::edge_quadric(std::uint32_t v0, std::uint32_t v1) const
+{
+	if (settings_.memoryless)
+	{
+		return local_quadric(v0) + local_quadric(v1);
+	}
+
+	return quadrics_[v0] + quadrics_[v1];
+}
+
+double QuadricDecimator::collapse_cost(std::uint32_t v0, std::uint32_t v1, Vector3d& position) const
+{
+	const Quadric quadric = edge_quadric(v0, v1);
+	const Vector3d p0(mesh_.positions[v0]);
+	const Vector3d p1(mesh_.positions[v1]);
+
+	if (!settings_.optimal_placement || !quadric.minimizer(position))
+	{
+		// the filter falls back to the endpoints, and the midpoint when placing optimally
+		position = quadric.evaluate(p0) <= quadric.evaluate(p1) ? p0 : p1;
+		if (settings_.optimal_placement)
+		{
+			const Vector3d midpoint = (p0 + p1) * 0.5;
+			if (quadric.evaluate(midpoint) < quadric.evaluate(position))
+			{
+				position = midpoint;
+			}
+		}
+	}
+
+	double min_quality = std::numeric_limits<double>::max();
+	for (const std::uint32_t vertex : {v0, v1})
+	{
+		for (const std::uint32_t f : vertex_faces_[vertex])
+		{
+			if (mesh_.face_removed[f])
+			{
+				continue;
+			}
+
+			const auto& face = mesh_.faces[f];
+			if ((face[0] == v0 || face[1] == v0 || face[2] == v0) && (face[0] == v1 || face[1] == v1 || face[2] == v1))
+			{
+				continue;
+			}
+
+			Vector3d before[3];
+			Vector3d after[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				before[i] = Vector3d(mesh_.positions[face[i]]);
+				after[i] = face[i] == vertex ? position : before[i];
+			}
+
+			const Vector3d normal_after = face_normal(after[0], after[1], after[2]);
+			if (settings_.preserve_normal && face_normal(before[0], before[1], before[2]).dot(normal_after) <= 0.0)
+			{
+				return std::numeric_limits<double>::infinity();
+			}
+			min_quality = std::min(min_quality, triangle_quality(after[0], after[1], after[2]));
+		}
+	}
+
+	double error = std::max(quadric.evaluate(position), 1e-15);
+	if (settings_.quality_threshold > 0.0)
+	{
+		// as in the filter, only faces below the threshold are penalised
+		min_quality = std::min(min_quality, settings_.quality_threshold);
+		if (min_quality <= 0.0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		error /= min_quality;
+	}
+
+	return error;
+}
+
+bool QuadricDecimator::link_condition_holds(std::uint32_t v0, std::uint32_t v1) const
+{
+	std::vector<std::uint32_t> ring0;
+	std::vector<std::uint32_t> ring1;
+	size_t shared_face_count = 0;
+
+	for (const std::uint32_t f : vertex_faces_[v0])
+	{
+		if (mesh_.face_removed[f])
+		{
+			continue;
+		}
+
+		const auto& face = mesh_.faces[f];
+		shared_face_count += face[0] == v1 || face[1] == v1 || face[2] == v1;
+		for (const std::uint32_t vertex : face)
+		{
+			if (vertex != v0 && vertex != v1)
+			{
+				ring0.push_back(vertex);
+			}
+		}
+	}
+	for (const std::uint32_t f : vertex_faces_[v1])
+	{
+		if (mesh_.face_removed[f])
+		{
+			continue;
+		}
+
+		for (const std::uint32_t vertex : mesh_.faces[f])
+		{
+			if (vertex != v0 && vertex != v1)
+			{
+				ring1.push_back(vertex);
+			}
+		}
+	}
+
+	std::sort(ring0.begin(), ring0.end());
+	ring0.erase(std::unique(ring0.begin(), ring0.end()), ring0.end());
+	std::sort(ring1.begin(), ring1.end());
+	ring1.erase(std::unique(ring1.begin(), ring1.end()), ring1.end());
+
+	std::vector<std::uint32_t> common;
+	std::set_intersection(ring0.begin(), ring0.end(), ring1.begin(), ring1.end(), std::back_inserter(common));
+
+	// the one rings may only meet at the apexes of the faces the collapse removes
+	return common.size() == shared_face_count;
+}
+
+size_t QuadricDecimator::collapse(std::uint32_t v0, std::uint32_t v1, const Vector3d& position)
+{
+	size_t removed_face_count = 0;
+	for (const std::uint32_t f : vertex_faces_[v1])
+	{
+		if (mesh_.face_removed[f])
+		{
+			continue;
+		}
+
+		auto& face = mesh_.faces[f];
+		if (face[0] == v0 || face[1] == v0 || face[2] == v0)
+		{
+			mesh_.face_removed[f] = 1;
+			++removed_face_count;
+			continue;
+		}
+
+		for (std::uint32_t& vertex : face)
+		{
+			if (vertex == v1)
+			{
+				vertex = v0;
+			}
+		}
+	}
+	vertex_faces_.merge(v0, v1, mesh_.face_removed);
+
+	mesh_.positions[v0] = position.to_float();
+	mesh_.vertex_removed[v1] = 1;
+	if (!settings_.memoryless)
+	{
+		quadrics_[v0] += quadrics_[v1];
+	}
+
+	return removed_face_count;
+}
+
+void QuadricDecimator::push_vertex_edges(std::uint32_t vertex)
+{
+	std::vector<std::uint32_t> ring;
+	gather_ring(vertex, ring);
+
+	// every edge pushed again leaves at least its old entry stale. purged before the heap would grow, once a
+	// quarter of it is stale, and at the latest once half of it is.
+	stale_entry_count_ += ring.size();
+	const bool full = heap_.size() + ring.size() > heap_.capacity();
+	if (stale_entry_count_ * 2 > heap_.size() || (full && stale_entry_count_ * 4 > heap_.size()))
+	{
+		purge_heap();
+	}
+
+	for (const std::uint32_t other : ring)
+	{
+		Vector3d position;
+		const double cost = collapse_cost(vertex, other, position);
+		heap_.push_back({queued_cost(cost), vertex, other, time_});
+		std::push_heap(heap_.begin(), heap_.end(), HeapOrder());
+	}
+}
+
+void QuadricDecimator::purge_heap()
+{
+	heap_.erase(std::remove_if(heap_.begin(), heap_.end(), [this](const HeapEntry& entry)
+	{
+		return mesh_.vertex_removed[entry.v0] || mesh_.vertex_removed[entry.v1]
+		       || entry.time < vertex_times_[entry.v0] || entry.time < vertex_times_[entry.v1];
+	}), heap_.end());
+	std::make_heap(heap_.begin(), heap_.end(), HeapOrder());
+
+	stale_entry_count_ = 0;
+}
+
+QuadricDecimator::FaceLists::Iterator::Iterator(const FaceLists* p_lists, std::uint32_t vertex)
+	: p_lists_(p_lists), vertex_(vertex)
+{
+	skip_empty_rows();
+}
+
+QuadricDecimator::FaceLists::Iterator& QuadricDecimator::FaceLists::Iterator::operator++()
+{
+	++index_;
+	skip_empty_rows();
+
+	return *this;
+}
+
+void QuadricDecimator::FaceLists::Iterator::skip_empty_rows()
+{
+	while (vertex_ != no_vertex && index_ == p_lists_->counts_[vertex_])
+	{
+		vertex_ = p_lists_->next_[vertex_];
+		index_ = 0;
+	}
+}
+
+QuadricDecimator::FaceLists::FaceLists(VertexFaceAdjacency adjacency)
+	: adjacency_(std::move(adjacency))
+{
+	const size_t vertex_count = adjacency_.offsets.size() - 1;
+	counts_.resize(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		counts_[v] = adjacency_.offsets[v + 1] - adjacency_.offsets[v];
+	}
+	next_.assign(vertex_count, no_vertex);
+}
+
+QuadricDecimator::FaceLists::Range QuadricDecimator::FaceLists::operator[](std::uint32_t vertex) const
+{
+	return {Iterator(this, vertex), Iterator(this, no_vertex)};
+}
+
+void QuadricDecimator::FaceLists::merge(std::uint32_t vertex, std::uint32_t removed,
+                                        const std::vector<std::uint8_t>& face_removed)
+{
+	// the faces of vertex first, then those of removed, as appending them would
+	thread_local std::vector<std::uint32_t> faces;
+	thread_local std::vector<std::uint32_t> rows;
+	faces.clear();
+	rows.clear();
+	for (const std::uint32_t first : {vertex, removed})
+	{
+		for (std::uint32_t row = first; row != no_vertex; row = next_[row])
+		{
+			rows.push_back(row);
+			const std::uint32_t* p_faces = adjacency_.face_ids.data() + adjacency_.offsets[row];
+			for (std::uint32_t i = 0; i < counts_[row]; ++i)
+			{
+				if (!face_removed[p_faces[i]])
+				{
+					faces.push_back(p_faces[i]);
+				}
+			}
+		}
+	}
+
+	// the rows together always hold the faces left. rows that stay empty drop out of the chain, but the
+	// first row stays at its head.
+	size_t written = 0;
+	std::uint32_t last = no_vertex;
+	for (const std::uint32_t row : rows)
+	{
+		const std::uint32_t capacity = adjacency_.offsets[row + 1] - adjacency_.offsets[row];
+		const std::uint32_t count = static_cast<std::uint32_t>(std::min<size_t>(capacity, faces.size() - written));
+		std::copy(faces.begin() + written, faces.begin() + written + count,
+		          adjacency_.face_ids.begin() + adjacency_.offsets[row]);
+		written += count;
+		counts_[row] = count;
+		next_[row] = no_vertex;
+
+		if (row == vertex || count != 0)
+		{
+			if (last != no_vertex)
+			{
+				next_[last] = row;
+			}
+			last = row;
+		}
+	}
+}
@@ -0,0 +1,218 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+#include "quadric.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// mirrors the quadric edge collapse filter parameters
+struct DecimationSettings
+{
+	size_t target_face_count = 0;
+	double quality_threshold = 0.3;
+	bool preserve_boundary = true;
+	double boundary_weight = 1.0;
+	bool preserve_normal = false;
+	bool preserve_topology = false;
+	bool optimal_placement = true;
+	bool planar_quadric = false;
+	double planar_weight = 0.001;
+	// 0 collapses the cheapest edge of the whole mesh each step. otherwise the cheapest of this many random
+	// edges is collapsed (multiple choice decimation): no priority queue, less memory, a slightly worse order.
+	// large meshes are then split into regions decimated in parallel, and only the seams are left to a last
+	// serial pass.
+	unsigned int candidate_count = 0;
+	// keep no quadrics: the error of a collapse is measured against the faces around the edge as they are
+	// now (memoryless simplification). saves a quadric per vertex at the cost of evaluating them each time.
+	bool memoryless = false;
+	// threads for the initialisation (quadrics, edge costs) and the regions of multiple choice decimation,
+	// 0 = one per hardware thread. the result does not depend on it.
+	unsigned int thread_count = 1;
+};
+
+// the settings the per-vertex quadrics depend on, and those the collapse costs depend on as well.
+std::uint64_t quadric_settings_key(const DecimationSettings& settings);
+std::uint64_t cost_settings_key(const DecimationSettings& settings);
+// every setting the decimated mesh depends on, all but the thread count.
+std::uint64_t decimation_settings_key(const DecimationSettings& settings);
+
+struct EdgeCollapse
+{
+	float cost;
+	std::uint32_t v0;
+	std::uint32_t v1;
+};
+
+// everything the decimation computes before its first collapse
+struct QuadricState
+{
+	std::vector<Quadric> quadrics;
+	// ascending cost; may be empty, then the costs are computed from the quadrics
+	std::vector<EdgeCollapse> collapses;
+};
+
+// greedy quadric error edge collapse over an IndexedMesh, the in-tree counterpart of the meshlab filter.
+// collapses rewrite the mesh in place: the surviving vertex of an edge moves, faces are relinked to it
+// and the faces and vertex the collapse consumes are flagged as removed.
+class QuadricDecimator
+{
+public:
+	// percent done, may throw to cancel
+	using ProgressFunction = std::function<void(int percent)>;
+
+	QuadricDecimator(IndexedMesh& mesh, const DecimationSettings& settings);
+
+	void initialize();
+	// false when the state does not belong to the mesh
+	bool initialize(QuadricState state);
+
+	// the state after initialize, the collapses sorted by cost (none for multiple choice decimation, and no
+	// quadrics when memoryless)
+	QuadricState initial_state() const;
+
+	void decimate(const ProgressFunction& progress = {});
+
+	size_t collapse_count() const;
+
+private:
+	struct Edge
+	{
+		std::uint32_t v0;
+		std::uint32_t v1;
+	};
+
+	struct HeapEntry
+	{
+		float cost;
+		std::uint32_t v0;
+		std::uint32_t v1;
+		// the entry is stale once either vertex changed after it
+		std::uint32_t time;
+	};
+
+	// a slab of the mesh decimated on its own: its faces have all their vertices in it
+	struct Region;
+
+	// the faces around every vertex, in the compressed rows of a VertexFaceAdjacency instead of a vector per
+	// vertex. a collapse hands the rows of the removed vertex to the survivor: the faces of a vertex fill its own
+	// row and then the rows chained after it. removed faces stay listed until the next merge drops them.
+	class FaceLists
+	{
+	public:
+		class Iterator
+		{
+		public:
+			Iterator(const FaceLists* p_lists, std::uint32_t vertex);
+
+			std::uint32_t operator*() const
+			{
+				return p_lists_->adjacency_.face_ids[p_lists_->adjacency_.offsets[vertex_] + index_];
+			}
+
+			Iterator& operator++();
+
+			bool operator!=(const Iterator& other) const
+			{
+				return vertex_ != other.vertex_ || index_ != other.index_;
+			}
+
+		private:
+			void skip_empty_rows();
+
+			const FaceLists* p_lists_;
+			std::uint32_t vertex_;
+			std::uint32_t index_ = 0;
+		};
+
+		struct Range
+		{
+			Iterator first;
+			Iterator last;
+
+			Iterator begin() const { return first; }
+			Iterator end() const { return last; }
+		};
+
+		explicit FaceLists(VertexFaceAdjacency adjacency);
+
+		Range operator[](std::uint32_t vertex) const;
+
+		// the faces of removed join those of vertex, leaving out the faces flagged in face_removed
+		void merge(std::uint32_t vertex, std::uint32_t removed, const std::vector<std::uint8_t>& face_removed);
+
+	private:
+		VertexFaceAdjacency adjacency_;
+		// faces in use of each row
+		std::vector<std::uint32_t> counts_;
+		// the row chained after each, no_vertex at the end
+		std::vector<std::uint32_t> next_;
+	};
+
+	void decimate_greedy(const ProgressFunction& progress);
+	void decimate_randomized(const ProgressFunction& progress);
+	std::vector<Region> partition_regions();
+	void decimate_regions(const ProgressFunction& progress);
+	// up to step_count collapses of edges whose faces all lie in the region
+	void decimate_region(Region& region, size_t step_count);
+	bool region_owns(std::uint32_t region, std::uint32_t v0, std::uint32_t v1) const;
+
+	// the vertices adjacent to vertex, ascending, in ring
+	void gather_ring(std::uint32_t vertex, std::vector<std::uint32_t>& ring) const;
+	// every edge once, ordered by its vertices
+	std::vector<Edge> unique_edges() const;
+	void compute_quadrics();
+	void build_heap(const std::vector<Edge>& edges);
+
+	// quadric of the faces around the vertex as they are now
+	Quadric local_quadric(std::uint32_t vertex) const;
+	Quadric edge_quadric(std::uint32_t v0, std::uint32_t v1) const;
+	double collapse_cost(std::uint32_t v0, std::uint32_t v1, Vector3d& position) const;
+	bool link_condition_holds(std::uint32_t v0, std::uint32_t v1) const;
+	// the number of faces removed. touches only the faces and vertices around the edge.
+	size_t collapse(std::uint32_t v0, std::uint32_t v1, const Vector3d& position);
+	void push_vertex_edges(std::uint32_t vertex);
+	// drops the entries of changed and removed vertices
+	void purge_heap();
+
+	IndexedMesh& mesh_;
+	DecimationSettings settings_;
+
+	// empty when memoryless
+	std::vector<Quadric> quadrics_;
+	FaceLists vertex_faces_;
+	std::vector<std::uint32_t> vertex_times_;
+	// region of each vertex while decimate_regions runs
+	std::vector<std::uint32_t> vertex_regions_;
+	std::vector<HeapEntry> heap_;
+	// a lower bound of the stale entries in heap_
+	size_t stale_entry_count_ = 0;
+
+	std::uint32_t time_ = 0;
+	size_t live_face_count_ = 0;
+	size_t collapse_count_ = 0;
+};
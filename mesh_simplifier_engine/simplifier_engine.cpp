@@ -0,0 +1,1079 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "simplifier_engine.h"
+
+#include "mesh_conversion.h"
+#include "mesh_deviation.h"
+#include "mesh_normals.h"
+#include "parallel.h"
+#include "point_cloud.h"
+#include "quadric_cache.h"
+#include "trace_writer.h"
+#include "vertex_welding.h"
+
+#include <common/globals.h>
+#include <common/mlexception.h>
+#include <common/parameters/rich_parameter_list.h>
+#include <common/plugins/plugin_manager.h>
+#include <common/utilities/load_save.h>
+
+#include <vcg/complex/append.h>
+#include <wrap/io_trimesh/io_mask.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+namespace
+{
+	constexpr size_t deviation_sample_count = 100000;
+
+	// vertex normals, face colors and wedge texture coordinates, as far as the output format has them
+	constexpr int export_mask = 4368;
+
+	std::uint64_t file_size_or_zero(const std::filesystem::path& file_path)
+	{
+		std::error_code error;
+		const std::uintmax_t size = std::filesystem::file_size(file_path, error);
+
+		return error ? 0 : size;
+	}
+
+	// bytes written for an exported obj: the geometry, its material library and the textures next to it.
+	std::uint64_t exported_bytes(const std::filesystem::path& output_file_path, const MeshModel& mesh_model)
+	{
+		std::uint64_t result = file_size_or_zero(output_file_path);
+
+		std::filesystem::path material_file_path = output_file_path;
+		result += file_size_or_zero(material_file_path.replace_extension(".mtl"));
+		result += file_size_or_zero(output_file_path.generic_string() + ".mtl");
+
+		for (const std::string& texture_name : mesh_model.cm.textures)
+		{
+			result += file_size_or_zero(output_file_path.parent_path() / texture_name);
+		}
+
+		return result;
+	}
+
+	bool export_mesh(QString output_file_path, PluginManager& plugin_manager, MeshDocument& mesh_document,
+	                 int mask, int texture_quality, FileMetrics& metrics)
+	{
+		bool saved = true;
+		if (output_file_path.isEmpty())
+		{
+			return false;
+		}
+
+		//save path away so we can use it again
+		QString output_directory_path = output_file_path;
+		output_directory_path.truncate(output_file_path.lastIndexOf("/"));
+
+		QString extension = output_file_path;
+		extension.remove(0, output_file_path.lastIndexOf('.') + 1);
+
+		IOPlugin* p_io_plugin = plugin_manager.outputMeshPlugin(extension);
+		if (p_io_plugin == nullptr)
+		{
+			return false;
+		}
+		p_io_plugin->setLog(&mesh_document.Log);
+
+		MeshModel* p_mesh_model = mesh_document.mm();
+
+		int capability = 0;
+		int default_bits = 0;
+		p_io_plugin->exportMaskCapability(extension, capability, default_bits);
+		const RichParameterList save_parameters = p_io_plugin->initSaveParameter(extension, *p_mesh_model);
+
+		try
+		{
+			QElapsedTimer stage_time;
+			stage_time.start();
+
+			{
+				TraceSpan span("export geometry", [&] { return output_file_path.toStdString(); });
+
+				p_io_plugin->save(extension, output_file_path, *p_mesh_model, mask, save_parameters, nullptr);
+				metrics.seconds(Stage::export_geometry) = stage_time.restart() / 1000.0;
+			}
+			{
+				TraceSpan span("save textures", [&] { return output_file_path.toStdString(); });
+
+				p_mesh_model->saveTextures(output_directory_path, texture_quality);
+				metrics.seconds(Stage::export_textures) = stage_time.elapsed() / 1000.0;
+			}
+
+			return true;
+		}
+		catch (const MLException& e)
+		{
+			return false;
+		}
+	}
+
+	// vertex colors and normals, as far as the points have them
+	int point_cloud_export_mask(const MeshModel& mesh_model)
+	{
+		int result = 0;
+		if (mesh_model.hasDataMask(MeshModel::MM_VERTCOLOR))
+		{
+			result |= vcg::tri::io::Mask::IOM_VERTCOLOR;
+		}
+		for (const CVertexO& vertex : mesh_model.cm.vert)
+		{
+			const vcg::Point3f& normal = vertex.cN();
+			if (!vertex.IsD() && (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f))
+			{
+				result |= vcg::tri::io::Mask::IOM_VERTNORMAL;
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	// optional CMeshO components that neither the quadric filter nor the exporter read. the obj importer leaves
+	// most of them off already and the filter re-enables the adjacency and marks it needs, so this only guards
+	// against an importer that enabled them; it is not a lean mesh. the fixed CMeshO components stay, since the
+	// filter plugin is built against CMeshO; only the in-tree engines decimate a lean IndexedMesh.
+	const int unused_component_mask = MeshModel::MM_VERTFACETOPO | MeshModel::MM_FACEFACETOPO |
+		MeshModel::MM_VERTMARK | MeshModel::MM_FACEMARK |
+		MeshModel::MM_VERTCURV | MeshModel::MM_VERTCURVDIR | MeshModel::MM_VERTRADIUS |
+		MeshModel::MM_VERTTEXCOORD | MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECURVDIR;
+
+	void trim_mesh_components(MeshModel& mesh_model)
+	{
+		mesh_model.clearDataMask(unused_component_mask);
+	}
+
+	bool import_mesh(QString input_file_name, PluginManager& plugin_manager, MeshDocument& mesh_document)
+	{
+		QStringList file_names;
+		file_names.push_back(input_file_name);
+		if (file_names.isEmpty())
+		{
+			return false;
+		}
+
+		for (const QString& file_name : file_names)
+		{
+			QFileInfo file_info(file_name);
+			if (!file_info.exists())
+			{
+				//QString error_msg_format = "Unable to open file:\n\"%1\"\n\nError details: file %1 does not exist.";
+
+				return false;
+			}
+			if (!file_info.isReadable())
+			{
+				//QString error_msg_format = "Unable to open file:\n\"%1\"\n\nError details: file %1 is not readable.";
+
+				return false;
+			}
+
+			QString extension = file_info.suffix();
+			IOPlugin* p_io_plugin = plugin_manager.inputMeshPlugin(extension);
+
+			if (p_io_plugin == nullptr)
+			{
+				// QString error_msg_format("Unable to open file:\n\"%1\"\n\nError details: file format " + extension + " not supported.");
+
+				return false;
+			}
+
+			p_io_plugin->setLog(&mesh_document.Log);
+			RichParameterList pre_parameters = p_io_plugin->initPreOpenParameter(extension);
+
+			const unsigned int mesh_count = p_io_plugin->numberMeshesContainedInFile(extension, file_name, pre_parameters);
+			QFileInfo info(file_name);
+			std::list<MeshModel*> mesh_model_ptrs;
+			for (unsigned int i = 0; i < mesh_count; i++)
+			{
+				MeshModel* p_mesh_model = mesh_document.addNewMesh(file_name, info.fileName());
+				if (mesh_count != 1)
+				{
+					p_mesh_model->setIdInFile(i);
+				}
+				mesh_model_ptrs.push_back(p_mesh_model);
+			}
+
+			try
+			{
+				std::list<int> masks;
+				std::list<std::string> unloaded_textures = meshlab::loadMesh(
+					file_name, p_io_plugin, pre_parameters, mesh_model_ptrs, masks, nullptr);
+
+				for (MeshModel* p_mesh_model : mesh_model_ptrs)
+				{
+					trim_mesh_components(*p_mesh_model);
+				}
+			}
+			catch (const MLException& e)
+			{
+				for (MeshModel* p_mesh_model : mesh_model_ptrs)
+				{
+					mesh_document.delMesh(p_mesh_model);
+				}
+
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	RichParameterList build_simplification_parameters(MeshModel const& mesh_model, const SimplifyOptions& options)
+	{
+		RichParameterList result;
+
+		result.addParam(RichInt("TargetFaceNum",
+		                        (0 < mesh_model.cm.sfn)
+			                        ? mesh_model.cm.sfn * options.target_face_ratio
+			                        : mesh_model.cm.fn * options.target_face_ratio, "Target number of faces",
+		                        "The desired final number of faces."));
+		result.addParam(RichFloat("TargetPerc", 0, "Percentage reduction (0..1)",
+		                          "If non zero, this parameter specifies the desired final size of the mesh as a percentage of the initial size."));
+		result.addParam(RichFloat("QualityThr", options.quality_threshold, "Quality threshold",
+		                          "Quality threshold for penalizing bad shaped faces.<br>The value is in the range [0..1]\n 0 accept any kind of face (no penalties),\n 0.5  penalize faces with quality < 0.5, proportionally to their shape\n"));
+		result.addParam(RichBool("PreserveBoundary", options.preserve_boundary, "Preserve Boundary of the mesh",
+		                         "The simplification process tries to do not affect mesh boundaries during simplification"));
+		result.addParam(RichFloat("BoundaryWeight", options.boundary_weight, "Boundary Preserving Weight",
+		                          "The importance of the boundary during simplification. Default (1.0) means that the boundary has the same importance of the rest. Values greater than 1.0 raise boundary importance and has the effect of removing less vertices on the border. Admitted range of values (0,+inf). "));
+		result.addParam(RichBool("PreserveNormal", options.preserve_normal, "Preserve Normal",
+		                         "Try to avoid face flipping effects and try to preserve the original orientation of the surface"));
+		result.addParam(RichBool("PreserveTopology", options.preserve_topology, "Preserve Topology",
+		                         "Avoid all the collapses that should cause a topology change in the mesh (like closing holes, squeezing handles, etc). If checked the genus of the mesh should stay unchanged."));
+		result.addParam(RichBool("OptimalPlacement", options.optimal_placement, "Optimal position of simplified vertices",
+		                         "Each collapsed vertex is placed in the position minimizing the quadric error.\n It can fail (creating bad spikes) in case of very flat areas. \nIf disabled edges are collapsed onto one of the two original vertices and the final mesh is composed by a subset of the original vertices. "));
+		result.addParam(RichBool("PlanarQuadric", options.planar_quadric, "Planar Simplification",
+		                         "Add additional simplification constraints that improves the quality of the simplification of the planar portion of the mesh, as a side effect, more triangles will be preserved in flat areas (allowing better shaped triangles)."));
+		result.addParam(RichFloat("PlanarWeight", options.planar_weight, "Planar Simp. Weight",
+		                          "How much we should try to preserve the triangles in the planar regions. If you lower this value planar areas will be simplified more."));
+		result.addParam(RichBool("QualityWeight", options.quality_weight, "Weighted Simplification",
+		                         "Use the Per-Vertex quality as a weighting factor for the simplification. The weight is used as a error amplification value, so a vertex with a high quality value will not be simplified and a portion of the mesh with low quality values will be aggressively simplified."));
+		result.addParam(RichBool("AutoClean", options.auto_clean, "Post-simplification cleaning",
+		                         "After the simplification an additional set of steps is performed to clean the mesh (unreferenced vertices, bad faces, etc)"));
+		result.addParam(RichBool("Selected", mesh_model.cm.sfn > 0, "Simplify only selected faces",
+		                         "The simplification is applied only to the selected set of faces.\n Take care of the target number of faces!"));
+
+		return result;
+	}
+
+	bool filter_call_back(const int pos, const char* str)
+	{
+		return ProgressScope::callback(pos, str);
+	}
+
+	bool simplify(MeshDocument& mesh_document, const QAction* p_filter_action, RichParameterList& parameters)
+	{
+		FilterPlugin* p_filter_plugin = qobject_cast<FilterPlugin*>(p_filter_action->parent());
+
+		try
+		{
+			// batch path: no undo snapshot of the document state is taken around the filter call
+			TraceSpan span("quadric edge collapse");
+
+			unsigned int post_condition_mask = MeshModel::MM_UNKNOWN;
+			p_filter_plugin->applyFilter(p_filter_action, parameters, mesh_document, post_condition_mask, filter_call_back);
+
+			return true;
+		}
+		catch (const std::bad_alloc& exception)
+		{
+			return false;
+		} catch (const MLException& exception)
+		{
+			return false;
+		} catch (const OperationCancelled& exception)
+		{
+			// the half-collapsed mesh is released together with its document by the caller
+			return false;
+		}
+	}
+
+	DecimationSettings build_decimation_settings(const MeshModel& mesh_model, const SimplifyOptions& options)
+	{
+		DecimationSettings result;
+		result.target_face_count = static_cast<size_t>(mesh_model.cm.fn * options.target_face_ratio);
+		result.quality_threshold = options.quality_threshold;
+		result.preserve_boundary = options.preserve_boundary;
+		result.boundary_weight = options.boundary_weight;
+		result.preserve_normal = options.preserve_normal;
+		result.preserve_topology = options.preserve_topology;
+		result.optimal_placement = options.optimal_placement;
+		result.planar_quadric = options.planar_quadric;
+		result.planar_weight = options.planar_weight;
+		result.candidate_count = (options.engine == DecimationEngine::random) ? options.random_candidates : 0;
+		result.memoryless = options.memoryless;
+		result.thread_count = options.decimation_threads;
+
+		return result;
+	}
+
+	// takes the initial state from the state file when it belongs to the mesh, and (re)writes the file when
+	// it did not or held no costs for these settings.
+	void initialize_decimator(QuadricDecimator& decimator, const IndexedMesh& mesh, const DecimationSettings& settings,
+	                          const std::filesystem::path& state_path)
+	{
+		if (state_path.empty())
+		{
+			decimator.initialize();
+			return;
+		}
+
+		TraceSpan span("quadric state", [&] { return state_path.generic_string(); });
+
+		const QuadricStateKey key = quadric_state_key(mesh, settings);
+		QuadricState state;
+		if (load_quadric_state(state_path, mesh, key, state))
+		{
+			const bool with_costs = !state.collapses.empty();
+			if (decimator.initialize(std::move(state)))
+			{
+				if (!with_costs)
+				{
+					store_quadric_state(state_path, key, decimator.initial_state());
+				}
+				return;
+			}
+		}
+
+		decimator.initialize();
+		store_quadric_state(state_path, key, decimator.initial_state());
+	}
+
+	bool decimate(MeshModel& mesh_model, const SimplifyOptions& options, const std::filesystem::path& quadric_state_path,
+	              InstanceLibrary* p_instance_library)
+	{
+		try
+		{
+			TraceSpan span("quadric decimation");
+
+			IndexedMesh mesh = to_indexed_mesh(mesh_model, options.decimation_threads);
+			const DecimationSettings settings = build_decimation_settings(mesh_model, options);
+			const QuadricDecimator::ProgressFunction progress = [](int percent)
+			{
+				ProgressScope::callback(percent, "Simplification: Quadric Edge Collapse");
+			};
+
+			if (options.instancing)
+			{
+				decimate_instances(mesh, settings, p_instance_library, progress);
+			}
+			else
+			{
+				QuadricDecimator decimator(mesh, settings);
+				initialize_decimator(decimator, mesh, settings, quadric_state_path);
+				decimator.decimate(progress);
+			}
+
+			if (options.auto_clean)
+			{
+				TraceSpan clean_span("clean");
+
+				clean_indexed_mesh(mesh, options.decimation_threads);
+			}
+			apply_indexed_mesh(mesh, mesh_model, options.decimation_threads);
+
+			return true;
+		}
+		catch (const std::bad_alloc& exception)
+		{
+			return false;
+		} catch (const OperationCancelled& exception)
+		{
+			return false;
+		}
+	}
+
+	// the filter's AutoClean, as parallel scans: flags null faces, merged duplicate vertices, the faces they
+	// leave degenerate and unreferenced vertices as deleted. the compaction follows separately.
+	void clean_mesh(MeshModel& mesh_model, unsigned int thread_count)
+	{
+		TraceSpan span("clean");
+
+		IndexedMesh mesh = to_indexed_mesh(mesh_model, thread_count);
+		clean_indexed_mesh(mesh, thread_count);
+		apply_indexed_mesh(mesh, mesh_model, thread_count);
+	}
+
+	// welds the vertices an exporter split along uv and normal seams, so collapses can cross them. the uvs stay
+	// on the wedges and the normals are recomputed after simplifying; meshes with per-vertex uvs (the in-memory
+	// path) are left alone, their seams are real.
+	void weld_mesh(MeshDocument& mesh_document, const SimplifyOptions& options)
+	{
+		MeshModel& mesh_model = *mesh_document.mm();
+		if (mesh_model.hasDataMask(MeshModel::MM_VERTTEXCOORD))
+		{
+			return;
+		}
+
+		TraceSpan span("weld");
+
+		IndexedMesh mesh = to_indexed_mesh(mesh_model, options.decimation_threads);
+		if (weld_vertices(mesh, options.weld_epsilon, options.decimation_threads) == 0)
+		{
+			return;
+		}
+		apply_indexed_mesh(mesh, mesh_model, options.decimation_threads);
+		compact_mesh(mesh_model, options.decimation_threads);
+	}
+
+	// what the filter runs after its AutoClean: the box, then normalized face and angle weighted vertex normals
+	void update_box_and_normals(MeshModel& mesh_model)
+	{
+		mesh_model.updateBoxAndNormals();
+		vcg::tri::UpdateNormal<CMeshO>::NormalizePerFace(mesh_model.cm);
+		vcg::tri::UpdateNormal<CMeshO>::NormalizePerVertex(mesh_model.cm);
+	}
+
+	// same counts, bounding box, positions, faces and vertex normals, in the same order
+	bool same_geometry(const MeshModel& expected, const MeshModel& actual, unsigned int thread_count)
+	{
+		if (expected.cm.vn != actual.cm.vn || expected.cm.fn != actual.cm.fn ||
+			expected.cm.vert.size() != actual.cm.vert.size() || expected.cm.bbox != actual.cm.bbox)
+		{
+			return false;
+		}
+
+		if (geometry_hash(to_indexed_mesh(expected, thread_count)) !=
+			geometry_hash(to_indexed_mesh(actual, thread_count)))
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < expected.cm.vert.size(); ++i)
+		{
+			if (expected.cm.vert[i].cN() != actual.cm.vert[i].cN())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool load_plugins(const std::filesystem::path& plugin_directory_path, PluginManager& plugin_manager)
+	{
+		try
+		{
+			const QDir plugin_directory_as_qdir(QString::fromUtf8((plugin_directory_path.generic_string().c_str())));
+
+			QCoreApplication::addLibraryPath(plugin_directory_as_qdir.absolutePath());
+			plugin_manager.loadPlugins(plugin_directory_as_qdir);
+
+			return true;
+		}
+		catch (const MLException& e)
+		{
+			return false;
+		}
+	}
+
+	// the copy shares nothing with the source, so variants can be simplified side by side.
+	void copy_mesh_model(const MeshModel& source, MeshModel& target)
+	{
+		target.updateDataMask(&source);
+		vcg::tri::Append<CMeshO, CMeshO>::MeshCopy(target.cm, source.cm);
+
+		for (const std::string& texture_name : source.cm.textures)
+		{
+			target.addTexture(texture_name, source.getTexture(texture_name));
+		}
+	}
+
+	QString to_qstring(const std::filesystem::path& path)
+	{
+		return QString::fromUtf8(path.generic_string().c_str());
+	}
+
+	// the parts of a mesh the exporter of the output's format can write
+	int export_capability(PluginManager& plugin_manager, const std::filesystem::path& output_path)
+	{
+		QString extension = to_qstring(output_path.extension());
+		extension.remove(0, 1);
+		IOPlugin* p_io_plugin = plugin_manager.outputMeshPlugin(extension);
+		if (p_io_plugin == nullptr)
+		{
+			return 0;
+		}
+
+		int capability = 0;
+		int default_bits = 0;
+		p_io_plugin->exportMaskCapability(extension, capability, default_bits);
+
+		return capability;
+	}
+
+	// runs one pipeline stage between the stage hooks; a failing stage is recorded in the result.
+	template <typename Function>
+	bool run_stage(SimplifyResult& result, const SimplifyHooks& hooks, const std::string& stage, Function&& function)
+	{
+		if (hooks.stage_started)
+		{
+			hooks.stage_started(stage);
+		}
+		const bool succeeded = function();
+		if (hooks.stage_finished)
+		{
+			hooks.stage_finished(stage);
+		}
+
+		if (!succeeded)
+		{
+			result.error_stage = stage;
+			result.metrics.peak_rss = peak_resident_set_size();
+		}
+
+		return succeeded;
+	}
+}
+
+SimplifierEngine::SimplifierEngine(const std::filesystem::path& plugin_directory_path)
+	: plugin_manager_(meshlab::pluginManagerInstance())
+{
+	static std::once_flag plugins_loaded;
+	std::call_once(plugins_loaded, [&]
+	{
+		TraceSpan span("plugin load");
+
+		load_plugins(plugin_directory_path, plugin_manager_);
+	});
+
+	p_filter_action_ = plugin_manager_.filterAction("Simplification: Quadric Edge Collapse Decimation");
+	if (p_filter_action_ != nullptr)
+	{
+		// nothing reads the filter log in batch use
+		qobject_cast<FilterPlugin*>(p_filter_action_->parent())->setLog(nullptr);
+	}
+}
+
+void SimplifierEngine::enable_mesh_cache(const std::filesystem::path& directory_path)
+{
+	p_mesh_cache_ = std::make_unique<MeshCache>(directory_path);
+}
+
+void SimplifierEngine::enable_quadric_cache()
+{
+	quadric_cache_enabled_ = true;
+}
+
+void SimplifierEngine::enable_instance_library()
+{
+	p_instance_library_ = std::make_unique<InstanceLibrary>();
+}
+
+bool SimplifierEngine::initialized() const
+{
+	return p_filter_action_ != nullptr;
+}
+
+SimplifyResult SimplifierEngine::simplify_file(const std::filesystem::path& input_path,
+                                               const std::filesystem::path& output_path,
+                                               const SimplifyOptions& options, const SimplifyHooks& hooks) const
+{
+	SimplifyResult result;
+
+	if (!initialized())
+	{
+		result.error_stage = "simplify";
+
+		return result;
+	}
+
+	const std::string input_path_as_string = input_path.generic_string();
+	TraceSpan file_span("file", input_path_as_string.c_str());
+
+	std::filesystem::path quadric_state_path;
+	if (quadric_cache_enabled_ && p_mesh_cache_ && options.engine == DecimationEngine::quadric && !options.memoryless &&
+		!options.instancing)
+	{
+		quadric_state_path = p_mesh_cache_->quadric_state_path(input_path);
+	}
+
+	MeshDocument mesh_document;
+	if (import_document(input_path, hooks, mesh_document, result) &&
+		simplify_document(mesh_document, input_path_as_string, options, hooks, result, quadric_state_path))
+	{
+		export_document(mesh_document, output_path, options, hooks, result);
+	}
+
+	return result;
+}
+
+SimplifyResult SimplifierEngine::simplify_point_cloud(const std::filesystem::path& input_path,
+                                                      const std::filesystem::path& output_path,
+                                                      const SimplifyOptions& options, const SimplifyHooks& hooks) const
+{
+	SimplifyResult result;
+
+	if (!initialized())
+	{
+		result.error_stage = "simplify";
+
+		return result;
+	}
+
+	const std::string input_path_as_string = input_path.generic_string();
+	TraceSpan file_span("file", input_path_as_string.c_str());
+
+	MeshDocument mesh_document;
+	if (!import_document(input_path, hooks, mesh_document, result, false))
+	{
+		return result;
+	}
+
+	// a header can promise no faces and the plugin still find some
+	if (mesh_document.mm()->cm.fn > 0)
+	{
+		if (simplify_document(mesh_document, input_path_as_string, options, hooks, result))
+		{
+			export_document(mesh_document, output_path, options, hooks, result);
+		}
+
+		return result;
+	}
+
+	FileMetrics& metrics = result.metrics;
+	metrics.vertices_in = mesh_document.mm()->cm.vn;
+
+	QElapsedTimer stage_time;
+	stage_time.start();
+
+	const bool reduced = run_stage(result, hooks, "simplify", [&]
+	{
+		try
+		{
+			TraceSpan span("point cloud", input_path_as_string.c_str());
+
+			MeshModel& mesh_model = *mesh_document.mm();
+			IndexedMesh cloud = to_indexed_mesh(mesh_model, options.decimation_threads);
+			// a ratio that rounds down to no point at all keeps one
+			const size_t target_count = std::max<size_t>(
+				static_cast<size_t>(cloud.live_vertex_count() * options.target_face_ratio), 1);
+			if (decimate_point_cloud(cloud, target_count, options.decimation_threads) > 0)
+			{
+				apply_indexed_mesh(cloud, mesh_model, options.decimation_threads);
+				compact_mesh(mesh_model, options.decimation_threads);
+				vcg::tri::UpdateBounding<CMeshO>::Box(mesh_model.cm);
+			}
+			metrics.seconds(Stage::simplify) = stage_time.elapsed() / 1000.0;
+
+			return true;
+		}
+		catch (const std::bad_alloc& exception)
+		{
+			return false;
+		}
+	});
+	if (reduced)
+	{
+		metrics.vertices_out = mesh_document.mm()->cm.vn;
+		export_document(mesh_document, output_path, options, hooks, result);
+	}
+
+	return result;
+}
+
+std::vector<VariantResult> SimplifierEngine::simplify_variants(const std::filesystem::path& input_path,
+                                                               const std::vector<VariantJob>& variants,
+                                                               unsigned int thread_count,
+                                                               const SimplifyHooks& hooks) const
+{
+	std::vector<VariantResult> results(variants.size());
+
+	SimplifyResult import_result;
+	MeshDocument source_document;
+	if (!initialized())
+	{
+		import_result.error_stage = "simplify";
+	}
+	else
+	{
+		TraceSpan span("file", [&] { return input_path.generic_string(); });
+
+		import_document(input_path, hooks, source_document, import_result);
+	}
+	if (!import_result.error_stage.empty())
+	{
+		for (VariantResult& result : results)
+		{
+			result.result = import_result;
+		}
+
+		return results;
+	}
+
+	const MeshModel& source_model = *source_document.mm();
+	parallel_for(variants.size(), thread_count, [&](size_t i)
+	{
+		const VariantJob& variant = variants[i];
+		const std::string label = input_path.generic_string() + " [" + variant.name + "]";
+		TraceSpan span("variant", label.c_str());
+
+		// the metrics of the shared import are reported with every variant
+		SimplifyResult& result = results[i].result;
+		result.metrics = import_result.metrics;
+
+		// a variant out of memory fails on its own instead of taking the sweep down
+		try
+		{
+			MeshDocument mesh_document;
+			copy_mesh_model(source_model, *mesh_document.addNewMesh(source_model.fullName(), source_model.label()));
+
+			if (!simplify_document(mesh_document, label, variant.options, hooks, result) ||
+				!export_document(mesh_document, variant.output_path, variant.options, hooks, result))
+			{
+				return;
+			}
+
+			results[i].deviation = measure_deviation(source_model, *mesh_document.mm(), deviation_sample_count);
+		}
+		catch (const std::bad_alloc& exception)
+		{
+			// the export sets succeeded, so only the deviation can have failed after it
+			result.error_stage = result.succeeded ? "deviation" : "simplify";
+			result.succeeded = false;
+		}
+	});
+
+	return results;
+}
+
+bool SimplifierEngine::import_document(const std::filesystem::path& input_path, const SimplifyHooks& hooks,
+                                       MeshDocument& mesh_document, SimplifyResult& result,
+                                       bool use_mesh_cache) const
+{
+	FileMetrics& metrics = result.metrics;
+	metrics.bytes_in = file_size_or_zero(input_path);
+
+	QElapsedTimer stage_time;
+	stage_time.start();
+
+	return run_stage(result, hooks, "import", [&]
+	{
+		TraceSpan span("import", [&] { return input_path.generic_string(); });
+
+		const QString input_path_as_qstring = to_qstring(input_path);
+		const bool cached = use_mesh_cache && p_mesh_cache_;
+		if (cached)
+		{
+			MeshModel* p_mesh_model = mesh_document.addNewMesh(input_path_as_qstring,
+			                                                   QFileInfo(input_path_as_qstring).fileName());
+			if (p_mesh_cache_->load(input_path, *p_mesh_model))
+			{
+				result.import_cached = true;
+				metrics.seconds(Stage::import_mesh) = stage_time.elapsed() / 1000.0;
+
+				return true;
+			}
+			mesh_document.delMesh(p_mesh_model);
+		}
+
+		std::lock_guard<std::mutex> lock(io_mutex_);
+
+		const bool succeeded = import_mesh(input_path_as_qstring, plugin_manager_, mesh_document);
+		metrics.seconds(Stage::import_mesh) = stage_time.elapsed() / 1000.0;
+
+		// files holding several meshes are always imported by the plugin
+		if (succeeded && cached && mesh_document.size() == 1)
+		{
+			p_mesh_cache_->store(input_path, *mesh_document.mm());
+		}
+
+		return succeeded;
+	});
+}
+
+bool SimplifierEngine::export_document(MeshDocument& mesh_document, const std::filesystem::path& output_path,
+                                       const SimplifyOptions& options, const SimplifyHooks& hooks,
+                                       SimplifyResult& result) const
+{
+	FileMetrics& metrics = result.metrics;
+
+	const bool exported = run_stage(result, hooks, "export", [&]
+	{
+		std::error_code error;
+		create_directories(output_path.parent_path(), error);
+
+		// every engine's output gets the same normals; points keep the normals they came with
+		const MeshModel& mesh_model = *mesh_document.mm();
+		const bool point_cloud = mesh_model.cm.fn == 0 && mesh_model.cm.vn > 0;
+		const int mask = export_capability(plugin_manager_, output_path) &
+			(point_cloud ? point_cloud_export_mask(mesh_model) : export_mask);
+		if (!point_cloud && (mask & vcg::tri::io::Mask::IOM_VERTNORMAL) != 0)
+		{
+			TraceSpan span("normals", [&] { return output_path.generic_string(); });
+
+			update_normals(*mesh_document.mm(), options.normal_weighting, options.decimation_threads);
+		}
+
+		std::lock_guard<std::mutex> lock(io_mutex_);
+
+		return export_mesh(to_qstring(output_path), plugin_manager_, mesh_document, mask, options.texture_quality,
+		                   metrics);
+	});
+	if (!exported)
+	{
+		return false;
+	}
+
+	metrics.bytes_out = exported_bytes(output_path, *mesh_document.mm());
+	metrics.peak_rss = peak_resident_set_size();
+	result.succeeded = true;
+
+	return true;
+}
+
+SimplifyResult SimplifierEngine::simplify_mesh(const MeshView& input, MeshData& output, const SimplifyOptions& options,
+                                               const SimplifyHooks& hooks) const
+{
+	return simplify_in_memory(input, options, hooks, [&](const MeshModel& mesh_model)
+	{
+		read_mesh_model(mesh_model, input.uvs != nullptr, input.normals != nullptr, output);
+
+		return true;
+	});
+}
+
+SimplifyResult SimplifierEngine::simplify_mesh(const MeshView& input, MeshBuffers& output,
+                                               const SimplifyOptions& options, const SimplifyHooks& hooks) const
+{
+	return simplify_in_memory(input, options, hooks, [&](const MeshModel& mesh_model)
+	{
+		return read_mesh_model(mesh_model, input.uvs != nullptr, input.normals != nullptr, output);
+	});
+}
+
+SimplifyResult SimplifierEngine::simplify_in_memory(const MeshView& input, const SimplifyOptions& options,
+                                                    const SimplifyHooks& hooks,
+                                                    const std::function<bool(const MeshModel&)>& write_output) const
+{
+	SimplifyResult result;
+	FileMetrics& metrics = result.metrics;
+
+	if (!initialized())
+	{
+		result.error_stage = "simplify";
+
+		return result;
+	}
+
+	metrics.bytes_in = mesh_view_bytes(input);
+
+	QElapsedTimer stage_time;
+	stage_time.start();
+
+	TraceSpan mesh_span("mesh", "memory");
+
+	MeshDocument mesh_document;
+	const bool imported = run_stage(result, hooks, "import", [&]
+	{
+		TraceSpan span("import", "memory");
+
+		if (!valid_mesh_view(input))
+		{
+			return false;
+		}
+
+		fill_mesh_model(input, *mesh_document.addNewMesh("", "memory"));
+		metrics.seconds(Stage::import_mesh) = stage_time.elapsed() / 1000.0;
+
+		return true;
+	});
+	if (!imported || !simplify_document(mesh_document, "memory", options, hooks, result))
+	{
+		return result;
+	}
+
+	MeshModel* p_mesh_model = mesh_document.mm();
+	stage_time.restart();
+
+	const bool exported = run_stage(result, hooks, "export", [&]
+	{
+		TraceSpan span("export geometry", "memory");
+
+		if (input.normals != nullptr)
+		{
+			update_normals(*p_mesh_model, options.normal_weighting, options.decimation_threads);
+		}
+		const bool succeeded = write_output(*p_mesh_model);
+		metrics.seconds(Stage::export_geometry) = stage_time.elapsed() / 1000.0;
+
+		return succeeded;
+	});
+	if (!exported)
+	{
+		return result;
+	}
+
+	metrics.bytes_out = mesh_model_bytes(*p_mesh_model, input.uvs != nullptr, input.normals != nullptr);
+	metrics.peak_rss = peak_resident_set_size();
+	result.succeeded = true;
+
+	return result;
+}
+
+bool SimplifierEngine::simplify_document(MeshDocument& mesh_document, const std::string& label,
+                                         const SimplifyOptions& options, const SimplifyHooks& hooks,
+                                         SimplifyResult& result, const std::filesystem::path& quadric_state_path) const
+{
+	FileMetrics& metrics = result.metrics;
+
+	MeshModel* p_mesh_model = mesh_document.mm();
+	metrics.vertices_in = p_mesh_model->cm.vn;
+	metrics.faces_in = p_mesh_model->cm.fn;
+
+	QElapsedTimer stage_time;
+	stage_time.start();
+
+	bool clean_check_failed = false;
+	const bool simplified = run_stage(result, hooks, "simplify", [&]
+	{
+		TraceSpan span("simplify", label.c_str());
+		ProgressScope progress(label, options.deadline_seconds, hooks.progress_log);
+
+		if (options.weld_epsilon > 0.0)
+		{
+			weld_mesh(mesh_document, options);
+		}
+
+		const bool in_tree = options.engine != DecimationEngine::filter;
+		bool succeeded = false;
+		MeshDocument reference_document;
+		if (in_tree && options.quality_weight)
+		{
+			if (hooks.progress_log)
+			{
+				hooks.progress_log("quality weight unsupported : " + label + " needs the filter engine");
+			}
+		}
+		else if (in_tree)
+		{
+			succeeded = decimate(*p_mesh_model, options, quadric_state_path, p_instance_library_.get());
+		}
+		else
+		{
+			// the filter itself, with its serial AutoClean, on a copy the parallel cleanup is compared against
+			if (options.verify_clean && options.auto_clean)
+			{
+				TraceSpan reference_span("clean reference");
+
+				copy_mesh_model(*p_mesh_model, *reference_document.addNewMesh(p_mesh_model->fullName(),
+				                                                              p_mesh_model->label()));
+				RichParameterList reference_parameters = build_simplification_parameters(*p_mesh_model, options);
+
+				std::lock_guard<std::mutex> lock(filter_mutex_);
+
+				if (!simplify(reference_document, p_filter_action_, reference_parameters))
+				{
+					return false;
+				}
+			}
+
+			// the filter's own AutoClean is serial; the same steps run below in parallel
+			SimplifyOptions filter_options = options;
+			filter_options.auto_clean = false;
+
+			RichParameterList simplification_parameters = build_simplification_parameters(*p_mesh_model, filter_options);
+			{
+				std::lock_guard<std::mutex> lock(filter_mutex_);
+
+				succeeded = simplify(mesh_document, p_filter_action_, simplification_parameters);
+			}
+			if (succeeded && options.auto_clean)
+			{
+				clean_mesh(*p_mesh_model, options.decimation_threads);
+			}
+		}
+
+		if (succeeded && (in_tree || options.auto_clean))
+		{
+			TraceSpan compact_span("compact");
+
+			compact_mesh(*p_mesh_model, options.decimation_threads);
+			if (in_tree)
+			{
+				// normals are left to the export, which recomputes them only when it writes them
+				vcg::tri::UpdateBounding<CMeshO>::Box(p_mesh_model->cm);
+			}
+			else
+			{
+				// the filter computed them before the cleanup merged and dropped vertices
+				update_box_and_normals(*p_mesh_model);
+			}
+		}
+		if (succeeded && reference_document.size() > 0 &&
+			!same_geometry(*reference_document.mm(), *p_mesh_model, options.decimation_threads))
+		{
+			if (hooks.progress_log)
+			{
+				hooks.progress_log("clean check failed : " + label + " differs from the filter's own AutoClean");
+			}
+			clean_check_failed = true;
+			succeeded = false;
+		}
+		metrics.seconds(Stage::simplify) = stage_time.elapsed() / 1000.0;
+		result.cancel_reason = progress.cancel_reason();
+
+		return succeeded;
+	});
+	if (!simplified)
+	{
+		if (clean_check_failed)
+		{
+			result.error_stage = "clean_check";
+		}
+
+		return false;
+	}
+
+	metrics.vertices_out = p_mesh_model->cm.vn;
+	metrics.faces_out = p_mesh_model->cm.fn;
+
+	return true;
+}
+
+std::vector<SimplifyResult> SimplifierEngine::simplify_batch(const std::vector<SimplifyJob>& jobs,
+                                                             unsigned int thread_count,
+                                                             const SimplifyHooks& hooks) const
+{
+	std::vector<SimplifyResult> results(jobs.size());
+
+	parallel_for(jobs.size(), thread_count, [&](size_t i)
+	{
+		if (interrupt_requested())
+		{
+			results[i].cancel_reason = "interrupted";
+
+			return;
+		}
+
+		results[i] = simplify_file(jobs[i].input_path, jobs[i].output_path, jobs[i].options, hooks);
+	});
+
+	return results;
+}
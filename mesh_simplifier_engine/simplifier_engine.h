@@ -0,0 +1,227 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "mesh_buffers.h"
+#include "mesh_cache.h"
+#include "mesh_deviation.h"
+#include "mesh_instancing.h"
+#include "mesh_normals.h"
+#include "progress.h"
+#include "stage_metrics.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MeshDocument;
+class MeshModel;
+class PluginManager;
+class QAction;
+
+// what collapses the edges
+enum class DecimationEngine
+{
+	// meshlab's quadric edge collapse filter
+	filter,
+	// the in-tree QuadricDecimator, the only one whose initial state the quadric cache keeps
+	quadric,
+	// the QuadricDecimator collapsing the cheapest of a few random edges each step, for throughput
+	random,
+};
+
+struct SimplifyOptions
+{
+	DecimationEngine engine = DecimationEngine::filter;
+
+	// fraction of the faces kept, (0..1]
+	float target_face_ratio = 0.3f;
+	// quadric edge collapse quality threshold, [0..1]
+	float quality_threshold = 0.3f;
+	// jpeg quality of the saved textures, [0..100]
+	int texture_quality = 50;
+
+	// the remaining quadric edge collapse parameters, named after the filter's own
+	bool preserve_boundary = true;
+	float boundary_weight = 1.0f;
+	bool preserve_normal = false;
+	bool preserve_topology = false;
+	bool optimal_placement = true;
+	bool planar_quadric = false;
+	float planar_weight = 0.001f;
+	// filter engine only, the quadric and random engines fail a file that sets it
+	bool quality_weight = false;
+	bool auto_clean = true;
+
+	// edges drawn per collapse by the random engine
+	unsigned int random_candidates = 8;
+	// the quadric and random engines keep no per-vertex quadrics, for a lower memory high-water
+	bool memoryless = false;
+	// threads for the parallel phases of the quadric and random engines, of the cleanup after any engine and
+	// of the normal recomputation, 0 = one per hardware thread
+	unsigned int decimation_threads = 1;
+	// the filter engine also runs the filter with its own serial AutoClean on a copy, and fails the file when
+	// the parallel cleanup leaves a different mesh. doubles the simplification time; for checking builds.
+	bool verify_clean = false;
+	// of the normals recomputed for the output
+	NormalWeighting normal_weighting = NormalWeighting::area;
+	// the quadric and random engines decimate every connected component on its own, and repeated components
+	// (copies under a rotation, uniform scale and translation) only once
+	bool instancing = false;
+	// vertices closer than this fraction of the bounding box diagonal are welded before simplifying, 0 = off
+	double weld_epsilon = 0.0;
+
+	// cancel the simplification after this many seconds, 0 = no deadline
+	double deadline_seconds = 0.0;
+};
+
+// optional callbacks, invoked on the thread that processes the file.
+struct SimplifyHooks
+{
+	// stage is "import", "simplify" or "export"
+	std::function<void(const std::string& stage)> stage_started;
+	std::function<void(const std::string& stage)> stage_finished;
+	ProgressScope::LogFunction progress_log;
+};
+
+struct SimplifyResult
+{
+	bool succeeded = false;
+	// "import", "simplify" or "export" when the file failed ("deviation" for a variant whose deviation could not
+	// be measured, "clean_check" when --verify-clean found a difference), empty when it was cancelled before it
+	// started
+	std::string error_stage;
+	// why the simplification was cancelled (deadline or interrupt), empty otherwise
+	std::string cancel_reason;
+	// the mesh came from the mesh cache instead of the io plugin
+	bool import_cached = false;
+	FileMetrics metrics;
+};
+
+struct SimplifyJob
+{
+	std::filesystem::path input_path;
+	std::filesystem::path output_path;
+	SimplifyOptions options;
+};
+
+struct VariantJob
+{
+	std::string name;
+	std::filesystem::path output_path;
+	SimplifyOptions options;
+};
+
+struct VariantResult
+{
+	SimplifyResult result;
+	// of the simplified mesh from the original, measured after a successful export
+	SurfaceDeviation deviation;
+};
+
+// imports, simplifies and exports meshes with the meshlab plugins. the plugins are loaded once per process;
+// a QCoreApplication has to exist before the first engine is constructed.
+// all the simplify_ calls may be made from several threads at once. meshlab's quadric filter keeps its quadrics
+// in a process-wide table, so calls of the filter engine are serialized; only the import, the export and the
+// in-tree engines run concurrently.
+class SimplifierEngine
+{
+public:
+	explicit SimplifierEngine(const std::filesystem::path& plugin_directory_path);
+
+	SimplifierEngine(const SimplifierEngine&) = delete;
+	SimplifierEngine& operator=(const SimplifierEngine&) = delete;
+
+	// imports go through a MeshCache in directory_path from now on; call before simplifying.
+	void enable_mesh_cache(const std::filesystem::path& directory_path);
+	// the quadric engine keeps its initial quadrics and collapse costs beside each mesh cache entry, so simplifying
+	// the same file again (at another target ratio, say) skips the initialisation. needs the mesh cache.
+	void enable_quadric_cache();
+	// components decimated with instancing are kept for the files simplified after them, so parts repeated
+	// across files are decimated once as well.
+	void enable_instance_library();
+
+	// false when the quadric edge collapse filter could not be found in the plugin directory.
+	bool initialized() const;
+
+	// writes the simplified mesh as an obj (plus material and textures) to output_path, creating its directory.
+	SimplifyResult simplify_file(const std::filesystem::path& input_path, const std::filesystem::path& output_path,
+	                             const SimplifyOptions& options, const SimplifyHooks& hooks = {}) const;
+
+	// imports the file once and simplifies a copy of it per variant, running up to thread_count variants at
+	// once (0 = one per hardware thread). results are in variant order and all carry the import metrics.
+	std::vector<VariantResult> simplify_variants(const std::filesystem::path& input_path,
+	                                             const std::vector<VariantJob>& variants,
+	                                             unsigned int thread_count = 0,
+	                                             const SimplifyHooks& hooks = {}) const;
+
+	// simplifies a mesh held in memory, without files or format parsing. the output has uvs and normals when
+	// the input has them; normals are recomputed on the simplified mesh.
+	SimplifyResult simplify_mesh(const MeshView& input, MeshData& output, const SimplifyOptions& options,
+	                             const SimplifyHooks& hooks = {}) const;
+	// fails in the export stage when the caller's buffers are too small; the result metrics carry the
+	// vertex and face counts needed.
+	SimplifyResult simplify_mesh(const MeshView& input, MeshBuffers& output, const SimplifyOptions& options,
+	                             const SimplifyHooks& hooks = {}) const;
+
+	// reduces a file of points without faces, such as a lidar scan, to target_face_ratio of its points with
+	// decimate_point_cloud instead of the edge collapse, and writes it as a ply (binary, with the colors and
+	// normals the points have) to output_path. only the thread count and the ratio of the options apply.
+	SimplifyResult simplify_point_cloud(const std::filesystem::path& input_path,
+	                                    const std::filesystem::path& output_path, const SimplifyOptions& options,
+	                                    const SimplifyHooks& hooks = {}) const;
+
+	// results are in job order. thread_count 0 uses one thread per hardware thread.
+	std::vector<SimplifyResult> simplify_batch(const std::vector<SimplifyJob>& jobs, unsigned int thread_count = 0,
+	                                           const SimplifyHooks& hooks = {}) const;
+
+private:
+	SimplifyResult simplify_in_memory(const MeshView& input, const SimplifyOptions& options,
+	                                  const SimplifyHooks& hooks,
+	                                  const std::function<bool(const MeshModel&)>& write_output) const;
+	// use_mesh_cache is false for point clouds, whose vertex colors the cache does not keep
+	bool import_document(const std::filesystem::path& input_path, const SimplifyHooks& hooks,
+	                     MeshDocument& mesh_document, SimplifyResult& result, bool use_mesh_cache = true) const;
+	bool export_document(MeshDocument& mesh_document, const std::filesystem::path& output_path,
+	                     const SimplifyOptions& options, const SimplifyHooks& hooks, SimplifyResult& result) const;
+	// the simplify stage shared by the file and the in-memory paths
+	// quadric_state_path names the persisted decimator state, empty for none
+	bool simplify_document(MeshDocument& mesh_document, const std::string& label, const SimplifyOptions& options,
+	                       const SimplifyHooks& hooks, SimplifyResult& result,
+	                       const std::filesystem::path& quadric_state_path = {}) const;
+
+	PluginManager& plugin_manager_;
+	QAction* p_filter_action_ = nullptr;
+	std::unique_ptr<MeshCache> p_mesh_cache_;
+	bool quadric_cache_enabled_ = false;
+	std::unique_ptr<InstanceLibrary> p_instance_library_;
+
+	// the io plugins keep per-call state in the shared plugin instances
+	mutable std::mutex io_mutex_;
+	// the quadric filter keeps its per-vertex quadrics in a static table (QHelper::TDp), one for all callers
+	mutable std::mutex filter_mutex_;
+};
@@ -0,0 +1,230 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "stage_metrics.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+
+namespace
+{
+	std::string format_decimal(double value, int precision)
+	{
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+
+		return buffer;
+	}
+
+	double to_megabytes(std::uint64_t bytes)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+
+	double sum(const std::vector<double>& samples)
+	{
+		return std::accumulate(samples.begin(), samples.end(), 0.0);
+	}
+
+	double rate(double amount, double seconds)
+	{
+		return (0.0 < seconds) ? amount / seconds : 0.0;
+	}
+}
+
+const char* stage_name(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::import_mesh:
+		return "import";
+	case Stage::simplify:
+		return "simplify";
+	case Stage::export_geometry:
+		return "export_geometry";
+	case Stage::export_textures:
+		return "export_textures";
+	}
+
+	return "unknown";
+}
+
+double FileMetrics::total_seconds() const
+{
+	return std::accumulate(stage_seconds.begin(), stage_seconds.end(), 0.0);
+}
+
+std::string format_file_metrics(const FileMetrics& metrics)
+{
+	std::string result;
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		result += stage_name(static_cast<Stage>(i));
+		result += "_ms=" + format_decimal(metrics.stage_seconds[i] * 1000.0, 1) + " ";
+	}
+	result += "faces_in=" + std::to_string(metrics.faces_in) + " ";
+	result += "faces_out=" + std::to_string(metrics.faces_out) + " ";
+	result += "bytes_in=" + std::to_string(metrics.bytes_in) + " ";
+	result += "bytes_out=" + std::to_string(metrics.bytes_out) + " ";
+	result += "peak_rss_mb=" + format_decimal(to_megabytes(metrics.peak_rss), 1);
+
+	return result;
+}
+
+void RunMetrics::add(const FileMetrics& metrics)
+{
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		stage_seconds_[i].push_back(metrics.stage_seconds[i]);
+	}
+
+	faces_in_ += metrics.faces_in;
+	faces_out_ += metrics.faces_out;
+	bytes_in_ += metrics.bytes_in;
+	bytes_out_ += metrics.bytes_out;
+	peak_rss_ = std::max(peak_rss_, metrics.peak_rss);
+}
+
+std::vector<std::string> RunMetrics::summary(double wall_seconds) const
+{
+	std::vector<std::string> lines;
+
+	const double import_seconds = stage_total_seconds(Stage::import_mesh);
+	const double simplify_seconds = stage_total_seconds(Stage::simplify);
+
+	lines.push_back("files=" + std::to_string(file_count()) +
+		" wall_s=" + format_decimal(wall_seconds, 2) +
+		" faces_in=" + std::to_string(faces_in_) +
+		" faces_out=" + std::to_string(faces_out_) +
+		" bytes_in=" + std::to_string(bytes_in_) +
+		" bytes_out=" + std::to_string(bytes_out_) +
+		" peak_rss_mb=" + format_decimal(to_megabytes(peak_rss_), 1));
+
+	lines.push_back("throughput faces_per_s=" + format_decimal(rate(static_cast<double>(faces_in_), wall_seconds), 0) +
+		" mb_per_s=" + format_decimal(rate(to_megabytes(bytes_in_ + bytes_out_), wall_seconds), 2) +
+		" import_mb_per_s=" + format_decimal(rate(to_megabytes(bytes_in_), import_seconds), 2) +
+		" simplify_faces_per_s=" + format_decimal(rate(static_cast<double>(faces_in_), simplify_seconds), 0));
+
+	for (size_t i = 0; i < stage_count; ++i)
+	{
+		const Stage stage = static_cast<Stage>(i);
+
+		std::string line = stage_name(stage);
+		line += " p50_ms=" + format_decimal(stage_percentile(stage, 0.50) * 1000.0, 1);
+		line += " p95_ms=" + format_decimal(stage_percentile(stage, 0.95) * 1000.0, 1);
+		line += " p99_ms=" + format_decimal(stage_percentile(stage, 0.99) * 1000.0, 1);
+
+		lines.push_back(line);
+	}
+
+	return lines;
+}
+
+size_t RunMetrics::file_count() const
+{
+	return stage_seconds_[0].size();
+}
+
+double RunMetrics::stage_percentile(Stage stage, double fraction) const
+{
+	return percentile(stage_seconds_[static_cast<size_t>(stage)], fraction);
+}
+
+double RunMetrics::stage_total_seconds(Stage stage) const
+{
+	return sum(stage_seconds_[static_cast<size_t>(stage)]);
+}
+
+double percentile(std::vector<double> samples, double fraction)
+{
+	if (samples.empty())
+	{
+		return 0.0;
+	}
+
+	const size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+	const size_t index = std::min(samples.size() - 1, (rank == 0) ? 0 : rank - 1);
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+
+	return samples[index];
+}
+
+std::uint64_t peak_resident_set_size()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+		return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+
+	return 0;
+#endif
+}
+
+std::uint64_t resident_set_size()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.WorkingSetSize;
+	}
+
+	return 0;
+#else
+	// second field of statm is the resident page count
+	std::ifstream statm("/proc/self/statm");
+	std::uint64_t size_pages = 0;
+	std::uint64_t resident_pages = 0;
+	if (statm >> size_pages >> resident_pages)
+	{
+		return resident_pages * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+
+	return 0;
+#endif
+}
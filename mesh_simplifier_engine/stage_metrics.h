@@ -0,0 +1,108 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Stage
+{
+	import_mesh,
+	simplify,
+	export_geometry,
+	export_textures,
+};
+
+constexpr size_t stage_count = 4;
+
+const char* stage_name(Stage stage);
+
+// measurements taken while processing a single file.
+struct FileMetrics
+{
+	std::array<double, stage_count> stage_seconds{};
+
+	long long vertices_in = 0;
+	long long vertices_out = 0;
+	long long faces_in = 0;
+	long long faces_out = 0;
+
+	std::uint64_t bytes_in = 0;
+	std::uint64_t bytes_out = 0;
+
+	// process-wide resident set high-water mark after the file was processed
+	std::uint64_t peak_rss = 0;
+
+	double& seconds(Stage stage)
+	{
+		return stage_seconds[static_cast<size_t>(stage)];
+	}
+
+	double seconds(Stage stage) const
+	{
+		return stage_seconds[static_cast<size_t>(stage)];
+	}
+
+	double total_seconds() const;
+};
+
+// single line of key=value pairs, suitable for grepping the batch log.
+std::string format_file_metrics(const FileMetrics& metrics);
+
+// aggregates the metrics of every successfully processed file of a run.
+class RunMetrics
+{
+public:
+	void add(const FileMetrics& metrics);
+
+	// throughput and per-stage latency percentiles, one line per entry.
+	std::vector<std::string> summary(double wall_seconds) const;
+
+	size_t file_count() const;
+	double stage_percentile(Stage stage, double fraction) const;
+	double stage_total_seconds(Stage stage) const;
+
+	long long faces_in() const { return faces_in_; }
+	long long faces_out() const { return faces_out_; }
+	std::uint64_t bytes_in() const { return bytes_in_; }
+	std::uint64_t bytes_out() const { return bytes_out_; }
+	std::uint64_t peak_rss() const { return peak_rss_; }
+
+private:
+	std::array<std::vector<double>, stage_count> stage_seconds_;
+
+	long long faces_in_ = 0;
+	long long faces_out_ = 0;
+	std::uint64_t bytes_in_ = 0;
+	std::uint64_t bytes_out_ = 0;
+	std::uint64_t peak_rss_ = 0;
+};
+
+// nearest-rank percentile of unsorted samples, 0 when there are none.
+double percentile(std::vector<double> samples, double fraction);
+
+std::uint64_t peak_resident_set_size();
+std::uint64_t resident_set_size();
@@ -0,0 +1,168 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "trace_writer.h"
+
+#include "json_string.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+
+namespace
+{
+	std::uint32_t current_thread_id()
+	{
+		// small sequential ids read better in the trace viewer than hashed native ids
+		static std::atomic<std::uint32_t> next_thread_id{1};
+		thread_local const std::uint32_t thread_id = next_thread_id.fetch_add(1);
+
+		return thread_id;
+	}
+}
+
+TraceWriter& TraceWriter::instance()
+{
+	static TraceWriter writer;
+
+	return writer;
+}
+
+void TraceWriter::enable(size_t capacity)
+{
+	events_ = std::vector<Event>(std::max<size_t>(capacity, 1));
+	next_event_ = 0;
+	origin_ = std::chrono::steady_clock::now();
+	enabled_ = true;
+}
+
+std::int64_t TraceWriter::now() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin_).count();
+}
+
+void TraceWriter::record(const char* name, std::string file, std::int64_t start_us, std::int64_t end_us)
+{
+	if (!enabled())
+	{
+		return;
+	}
+
+	const std::uint64_t index = next_event_.fetch_add(1, std::memory_order_relaxed);
+
+	Event& event = events_[index % events_.size()];
+	if (event.busy.exchange(true, std::memory_order_acquire))
+	{
+		return;
+	}
+
+	event.sequence = index;
+	event.name = name;
+	event.file = std::move(file);
+	event.start_us = start_us;
+	event.duration_us = end_us - start_us;
+	event.thread_id = current_thread_id();
+
+	event.busy.store(false, std::memory_order_release);
+}
+
+bool TraceWriter::write(const std::filesystem::path& trace_file_path) const
+{
+	std::ofstream stream(trace_file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!stream.is_open())
+	{
+		return false;
+	}
+
+	const std::uint64_t event_count = std::min<std::uint64_t>(next_event_.load(), events_.size());
+	const std::uint64_t first_event = next_event_.load() - event_count;
+
+	std::set<std::uint32_t> thread_ids;
+	bool first = true;
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (std::uint64_t i = first_event; i < first_event + event_count; ++i)
+	{
+		// a dropped span leaves its slot to an older one
+		const Event& event = events_[i % events_.size()];
+		if (event.name == nullptr || event.sequence != i)
+		{
+			continue;
+		}
+		thread_ids.insert(event.thread_id);
+
+		stream << (first ? "\n" : ",\n");
+		stream << "{\"name\":" << to_json_string(event.name) << ",\"cat\":\"mesh_simplifier\",\"ph\":\"X\"";
+		stream << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us;
+		stream << ",\"pid\":1,\"tid\":" << event.thread_id;
+		if (!event.file.empty())
+		{
+			stream << ",\"args\":{\"file\":" << to_json_string(event.file) << "}";
+		}
+		stream << "}";
+
+		first = false;
+	}
+	for (const std::uint32_t thread_id : thread_ids)
+	{
+		stream << (first ? "\n" : ",\n");
+		stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread_id;
+		stream << ",\"args\":{\"name\":\"" << (thread_id == 1 ? "main" : "worker " + std::to_string(thread_id)) << "\"}}";
+
+		first = false;
+	}
+	stream << "\n]}\n";
+
+	return stream.good();
+}
+
+TraceSpan::TraceSpan(const char* name, const char* file)
+	: name_(name)
+{
+	if (TraceWriter::instance().enabled())
+	{
+		start(file);
+	}
+}
+
+TraceSpan::~TraceSpan()
+{
+	finish();
+}
+
+void TraceSpan::finish()
+{
+	if (0 <= start_us_)
+	{
+		TraceWriter& writer = TraceWriter::instance();
+		writer.record(name_, std::move(file_), start_us_, writer.now());
+
+		start_us_ = -1;
+	}
+}
+
+void TraceSpan::start(std::string file)
+{
+	file_ = std::move(file);
+	start_us_ = TraceWriter::instance().now();
+}
@@ -0,0 +1,108 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+// records complete ("X") spans into a fixed size ring buffer and writes them as chrome trace-event json,
+// which can be opened in perfetto or chrome://tracing. when the ring is full the oldest spans are overwritten.
+class TraceWriter
+{
+public:
+	static TraceWriter& instance();
+
+	void enable(size_t capacity);
+	bool enabled() const
+	{
+		return enabled_.load(std::memory_order_relaxed);
+	}
+
+	// microseconds since tracing was enabled
+	std::int64_t now() const;
+
+	// name must be a string literal; file may be empty. a span whose ring slot is still being written by a thread
+	// a whole ring behind is dropped.
+	void record(const char* name, std::string file, std::int64_t start_us, std::int64_t end_us);
+
+	// writes the retained spans; must not race with record().
+	bool write(const std::filesystem::path& trace_file_path) const;
+
+private:
+	struct Event
+	{
+		// set while a thread fills the slot
+		std::atomic<bool> busy{false};
+		// index of the span the slot holds
+		std::uint64_t sequence = 0;
+		const char* name = nullptr;
+		std::string file;
+		std::int64_t start_us = 0;
+		std::int64_t duration_us = 0;
+		std::uint32_t thread_id = 0;
+	};
+
+	std::atomic<bool> enabled_{false};
+	std::atomic<std::uint64_t> next_event_{0};
+	std::vector<Event> events_;
+	std::chrono::steady_clock::time_point origin_;
+};
+
+// span covering the lifetime of the object; costs a relaxed load when tracing is disabled. the file is copied
+// only when tracing is enabled, and given as a callable when building it would cost anything.
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* name, const char* file = "");
+
+	template <typename FileFunction, typename = decltype(std::string(std::declval<FileFunction&>()()))>
+	TraceSpan(const char* name, FileFunction&& file)
+		: name_(name)
+	{
+		if (TraceWriter::instance().enabled())
+		{
+			start(file());
+		}
+	}
+
+	~TraceSpan();
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+	// ends the span before the end of the enclosing scope.
+	void finish();
+
+private:
+	void start(std::string file);
+
+	const char* name_;
+	std::string file_;
+	std::int64_t start_us_ = -1;
+};
@@ -0,0 +1,196 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#include "vertex_welding.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	constexpr size_t chunk_size = 4096;
+
+	struct Cell
+	{
+		std::int64_t x;
+		std::int64_t y;
+		std::int64_t z;
+	};
+
+	size_t cell_hash(const Cell& cell)
+	{
+		return static_cast<size_t>((static_cast<std::uint64_t>(cell.x) * 73856093u) ^
+			(static_cast<std::uint64_t>(cell.y) * 19349663u) ^ (static_cast<std::uint64_t>(cell.z) * 83492791u));
+	}
+
+	double bounding_diagonal(const IndexedMesh& mesh)
+	{
+		Vector3d low(std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+		             std::numeric_limits<double>::max());
+		Vector3d high = low * -1.0;
+		for (size_t v = 0; v < mesh.vertex_count(); ++v)
+		{
+			if (mesh.is_vertex_removed(v))
+			{
+				continue;
+			}
+
+			const auto& p = mesh.positions[v];
+			low = {std::min<double>(low.x, p[0]), std::min<double>(low.y, p[1]), std::min<double>(low.z, p[2])};
+			high = {std::max<double>(high.x, p[0]), std::max<double>(high.y, p[1]), std::max<double>(high.z, p[2])};
+		}
+
+		return (low.x <= high.x) ? (high - low).length() : 0.0;
+	}
+}
+
+size_t weld_vertices(IndexedMesh& mesh, double epsilon, unsigned int thread_count)
+{
+	const size_t vertex_count = mesh.vertex_count();
+	const double distance = epsilon * bounding_diagonal(mesh);
+	if (vertex_count == 0 || !(distance > 0.0))
+	{
+		return 0;
+	}
+	mesh.vertex_removed.resize(vertex_count, 0);
+	mesh.face_removed.resize(mesh.face_count(), 0);
+
+	std::vector<Cell> cells(vertex_count);
+	parallel_for_chunks(vertex_count, chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			const auto& p = mesh.positions[v];
+			cells[v] = {static_cast<std::int64_t>(std::floor(p[0] / distance)),
+			            static_cast<std::int64_t>(std::floor(p[1] / distance)),
+			            static_cast<std::int64_t>(std::floor(p[2] / distance))};
+		}
+	});
+
+	// buckets in compressed rows, each listing its vertices in ascending order
+	size_t bucket_count = 1;
+	while (bucket_count < vertex_count * 2)
+	{
+		bucket_count *= 2;
+	}
+	std::vector<std::uint32_t> bucket_offsets(bucket_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		if (!mesh.vertex_removed[v])
+		{
+			++bucket_offsets[(cell_hash(cells[v]) & (bucket_count - 1)) + 1];
+		}
+	}
+	for (size_t b = 0; b < bucket_count; ++b)
+	{
+		bucket_offsets[b + 1] += bucket_offsets[b];
+	}
+	std::vector<std::uint32_t> bucket_vertices(bucket_offsets.back());
+	std::vector<std::uint32_t> cursor(bucket_offsets.begin(), bucket_offsets.end() - 1);
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		if (!mesh.vertex_removed[v])
+		{
+			bucket_vertices[cursor[cell_hash(cells[v]) & (bucket_count - 1)]++] = static_cast<std::uint32_t>(v);
+		}
+	}
+
+	// the lowest vertex within distance, searched in the 27 cells around each vertex
+	std::vector<std::uint32_t> representative(vertex_count);
+	const double squared_distance = distance * distance;
+	parallel_for_chunks(vertex_count, chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			representative[v] = static_cast<std::uint32_t>(v);
+			if (mesh.vertex_removed[v])
+			{
+				continue;
+			}
+
+			const Vector3d p(mesh.positions[v]);
+			for (std::int64_t dx = -1; dx <= 1; ++dx)
+			{
+				for (std::int64_t dy = -1; dy <= 1; ++dy)
+				{
+					for (std::int64_t dz = -1; dz <= 1; ++dz)
+					{
+						const Cell cell = {cells[v].x + dx, cells[v].y + dy, cells[v].z + dz};
+						const size_t bucket = cell_hash(cell) & (bucket_count - 1);
+						for (std::uint32_t i = bucket_offsets[bucket]; i < bucket_offsets[bucket + 1]; ++i)
+						{
+							const std::uint32_t other = bucket_vertices[i];
+							if (other >= representative[v])
+							{
+								break;
+							}
+							if ((Vector3d(mesh.positions[other]) - p).squared_length() <= squared_distance)
+							{
+								representative[v] = other;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	});
+
+	// representatives are lower, so one ascending pass resolves the chains
+	size_t welded_count = 0;
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		representative[v] = representative[representative[v]];
+		if (representative[v] != v)
+		{
+			mesh.vertex_removed[v] = 1;
+			++welded_count;
+		}
+	}
+
+	parallel_for_chunks(mesh.face_count(), chunk_size, thread_count, [&](size_t begin, size_t end)
+	{
+		for (size_t f = begin; f < end; ++f)
+		{
+			if (mesh.face_removed[f])
+			{
+				continue;
+			}
+
+			auto& face = mesh.faces[f];
+			for (std::uint32_t& vertex : face)
+			{
+				vertex = representative[vertex];
+			}
+			if (face[0] == face[1] || face[1] == face[2] || face[2] == face[0])
+			{
+				mesh.face_removed[f] = 1;
+			}
+		}
+	});
+
+	return welded_count;
+}
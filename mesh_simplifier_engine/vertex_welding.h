@@ -0,0 +1,32 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2021                                                \/)\/    *
+* JI-IN Systems.                                                  /\/|      *
+*                                                                    |      *
+* All rights reserved.                                               \      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+
+#pragma once
+
+#include "indexed_mesh.h"
+
+// merges every vertex into the lowest indexed vertex within epsilon of it (chains included), relinks the
+// faces and flags the merged vertices, and the faces left with a repeated vertex, as removed. epsilon is a
+// fraction of the bounding box diagonal. the neighbours are found through a spatial hash grid of epsilon
+// sized cells, queried in parallel; the result does not depend on thread_count. returns the merged count.
+size_t weld_vertices(IndexedMesh& mesh, double epsilon, unsigned int thread_count = 1);